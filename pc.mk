@@ -1,16 +1,28 @@
 TARGET := app
 
 SOURCES := $(wildcard src/*.c) $(wildcard src/*.cpp) $(wildcard src/ext/*.c) $(wildcard src/ext/*.cpp) $(wildcard src/game/*.c) $(wildcard src/game/*.cpp) $(wildcard src/gfx/*.c) $(wildcard src/gfx/*.cpp) $(wildcard src/math/*.c) $(wildcard src/math/*.cpp) $(wildcard pc/*.c) $(wildcard pc/ogc/*.c) $(wildcard pc/wiiuse/*.c)
-LIBS := -lm
+LIBS := -lm -lpthread
 WARNS := -Wall
-OBJECTS := $(patsubst %.c,%.o,$(patsubst %.cpp,%.o,$(SOURCES)))
-DEPENDS := $(patsubst %.c,%.d,$(patsubst %.cpp,%.d,$(SOURCES)))
+# Objects are built next to their sources unless OBJ_DIR is set, which lets the region size variants build side by side
+OBJ_DIR :=
+OBJECTS := $(addprefix $(OBJ_DIR),$(patsubst %.c,%.o,$(patsubst %.cpp,%.o,$(SOURCES))))
+DEPENDS := $(addprefix $(OBJ_DIR),$(patsubst %.c,%.d,$(patsubst %.cpp,%.d,$(SOURCES))))
+
+# Region dimensions as XxYxZ, each is built into $(TARGET)_XxYxZ.elf by region_size_variants
+REGION_SIZE_VARIANTS := 8x8x8 16x16x16 32x32x32 16x32x16 16x64x16
+get_region_size_flags = -DREGION_SIZE_X=$(word 1,$(subst x, ,$(1))) -DREGION_SIZE_Y=$(word 2,$(subst x, ,$(1))) -DREGION_SIZE_Z=$(word 3,$(subst x, ,$(1)))
+
+# Every VOXEL_LAYOUT is built into voxel_layout_bench_<layout>.elf and run by voxel_layout_bench, which times generation, meshing and raycasts on a fixed world
+VOXEL_LAYOUTS := XYZ YXZ MORTON
+VOXEL_LAYOUT_BENCH_SOURCES := pc/bench/voxel_layout_bench.c src/chrono.c src/log.c src/game_math.c src/math/box.c src/math/box_raycast.c src/game/voxel.c src/game/voxel_type_info.c src/game/voxel_raycast.c src/game/region.c src/game/region_procedural_generation.c src/game/region_visual_generation.c src/game/region_mesh_cache.c src/game/display_list_pool.c pc/ogc/cache.c pc/ogc/lwp.c
+# Runs each benchmark, e.g. BENCH_RUNNER="perf stat -e cache-references,cache-misses" to also count cache misses
+BENCH_RUNNER :=
 
 override XFLAGS += -O3 -fno-exceptions -I lib -I src -isystem/opt/devkitpro/libogc/include -D__wii__ -DHW_RVL -DPC_PORT -g
 CFLAGS = $(XFLAGS) -std=c2x
 CXXFLAGS = $(XFLAGS) -std=c++2a
 
-.PHONY: build run clean
+.PHONY: build run clean region_size_variants voxel_layout_bench
 
 build: $(OBJECTS)
 	$(CXX) $(CFLAGS) -o $(TARGET).elf $(OBJECTS) $(LIBS)
@@ -18,13 +30,23 @@ build: $(OBJECTS)
 run: build
 	@./$(TARGET).elf
 
+region_size_variants:
+	$(foreach variant,$(REGION_SIZE_VARIANTS),$(MAKE) -f pc.mk build TARGET=$(TARGET)_$(variant) OBJ_DIR=region_size_variants/$(variant)/ XFLAGS="$(call get_region_size_flags,$(variant))" &&) true
+
+voxel_layout_bench:
+	$(foreach layout,$(VOXEL_LAYOUTS),$(CC) $(CFLAGS) $(WARNS) -DVOXEL_LAYOUT=VOXEL_LAYOUT_$(layout) -o voxel_layout_bench_$(layout).elf $(VOXEL_LAYOUT_BENCH_SOURCES) $(LIBS) && $(BENCH_RUNNER) ./voxel_layout_bench_$(layout).elf &&) true
+
 clean:
 	$(RM) $(OBJECTS) $(DEPENDS)
+	$(RM) -r region_size_variants $(foreach variant,$(REGION_SIZE_VARIANTS),$(TARGET)_$(variant).elf)
+	$(RM) $(foreach layout,$(VOXEL_LAYOUTS),voxel_layout_bench_$(layout).elf)
 
 -include $(DEPENDS)
 
-%.o: %.c Makefile
+$(OBJ_DIR)%.o: %.c Makefile
+	@mkdir -p $(@D)
 	$(CC) $(CFLAGS) $(WARNS) -MMD -MP -c $< -o $@
 
-%.o: %.cpp Makefile
+$(OBJ_DIR)%.o: %.cpp Makefile
+	@mkdir -p $(@D)
 	$(CXX) $(CXXFLAGS) $(WARNS) -MMD -MP -c $< -o $@
\ No newline at end of file
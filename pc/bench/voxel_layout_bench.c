@@ -0,0 +1,154 @@
+// Times region generation, meshing and raycasts on a fixed world, to compare the VOXEL_LAYOUT policies.
+// make -f pc.mk voxel_layout_bench builds and runs it once for every layout, the mesh bytes and raycast hits printed with the times have to match between layouts.
+#include "chrono.h"
+#include "game/display_list_pool.h"
+#include "game/region.h"
+#include "game/region_management.h"
+#include "game/region_mesh_cache.h"
+#include "game/region_procedural_generation.h"
+#include "game/region_visual_generation.h"
+#include "game/voxel_raycast.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_WORLD_SIZE_X 8
+#define BENCH_WORLD_SIZE_Y 3
+#define BENCH_WORLD_SIZE_Z 8
+// Each round generates and meshes the world further along x, so that every round is different terrain
+#define NUM_BENCH_ROUNDS 5
+#define NUM_BENCH_RAYCASTS 20000
+// As far as the voxel selection reaches in the game
+#define BENCH_RAYCAST_LENGTH 10.0f
+
+static voxel_type_array_t bench_voxel_type_arrays[BENCH_WORLD_SIZE_X][BENCH_WORLD_SIZE_Y][BENCH_WORLD_SIZE_Z];
+static s32vec3s bench_corner_region_pos;
+
+static region_mesh_buffers_t mesh_buffers;
+
+// The raycasts look up voxels through these like in the game, only from the benchmark's world instead of the loaded regions
+const voxel_type_array_t* get_voxel_type_array_from_region_position(s32vec3s region_pos) {
+    s32 x = region_pos.x - bench_corner_region_pos.x;
+    s32 y = region_pos.y - bench_corner_region_pos.y;
+    s32 z = region_pos.z - bench_corner_region_pos.z;
+    if (x < 0 || y < 0 || z < 0 || x >= BENCH_WORLD_SIZE_X || y >= BENCH_WORLD_SIZE_Y || z >= BENCH_WORLD_SIZE_Z) {
+        return NULL;
+    }
+    return &bench_voxel_type_arrays[x][y][z];
+}
+
+voxel_type_wrap_t get_voxel_type_from_voxel_world_position(s32vec3s voxel_world_pos) {
+    const voxel_type_array_t* voxel_types = get_voxel_type_array_from_region_position(get_region_position_from_voxel_world_position(voxel_world_pos));
+    if (voxel_types == NULL) {
+        return (voxel_type_wrap_t) { .success = false };
+    }
+
+    u32vec3s voxel_local_pos = get_voxel_local_position_from_voxel_world_position(voxel_world_pos);
+    return (voxel_type_wrap_t) {
+        .success = true,
+        .val = get_voxel_type_from_array(voxel_types, voxel_local_pos.x, voxel_local_pos.y, voxel_local_pos.z)
+    };
+}
+
+static us_t generate_bench_world(void) {
+    s64 start = get_current_us();
+    for (s32 x = 0; x < BENCH_WORLD_SIZE_X; x++) {
+        for (s32 y = 0; y < BENCH_WORLD_SIZE_Y; y++) {
+            for (s32 z = 0; z < BENCH_WORLD_SIZE_Z; z++) {
+                voxel_type_array_t* voxel_types = &bench_voxel_type_arrays[x][y][z];
+                free_voxel_type_array(voxel_types);
+                generate_region_voxels((s32vec3s) {{ bench_corner_region_pos.x + x, bench_corner_region_pos.y + y, bench_corner_region_pos.z + z }}, voxel_types);
+            }
+        }
+    }
+    return (us_t) (get_current_us() - start);
+}
+
+static const voxel_type_array_t* get_bench_voxel_type_array(s32 x, s32 y, s32 z) {
+    return get_voxel_type_array_from_region_position((s32vec3s) {{ bench_corner_region_pos.x + x, bench_corner_region_pos.y + y, bench_corner_region_pos.z + z }});
+}
+
+// Meshes every region of the world under full sky light. The meshes are freed right away, so each region is meshed instead of shared from the mesh cache.
+static us_t mesh_bench_world(size_t* num_mesh_bytes) {
+    const voxel_light_array_t lights = { .data = NULL, .uniform_light = get_voxel_light(MAX_LIGHT_LEVEL, 0) };
+
+    us_t time = 0;
+    for (s32 x = 0; x < BENCH_WORLD_SIZE_X; x++) {
+        for (s32 y = 0; y < BENCH_WORLD_SIZE_Y; y++) {
+            for (s32 z = 0; z < BENCH_WORLD_SIZE_Z; z++) {
+                const voxel_type_array_t* neighbor_voxel_types[6] = {
+                    get_bench_voxel_type_array(x + 1, y, z),
+                    get_bench_voxel_type_array(x - 1, y, z),
+                    get_bench_voxel_type_array(x, y + 1, z),
+                    get_bench_voxel_type_array(x, y - 1, z),
+                    get_bench_voxel_type_array(x, y, z + 1),
+                    get_bench_voxel_type_array(x, y, z - 1)
+                };
+                const voxel_type_array_t* edge_neighbor_voxel_types[NUM_REGION_EDGE_NEIGHBORS];
+                for (size_t i = 0; i < NUM_REGION_EDGE_NEIGHBORS; i++) {
+                    edge_neighbor_voxel_types[i] = get_bench_voxel_type_array(x + region_edge_neighbor_offsets[i].x, y + region_edge_neighbor_offsets[i].y, z + region_edge_neighbor_offsets[i].z);
+                }
+                region_apron_edges_t apron_edges;
+                copy_region_apron_edges(&apron_edges, edge_neighbor_voxel_types);
+                const voxel_light_array_t* neighbor_lights[6];
+                for (u8 face = 0; face < 6; face++) {
+                    neighbor_lights[face] = neighbor_voxel_types[face] == NULL ? NULL : &lights;
+                }
+
+                region_render_info_t render_info = { 0 };
+                s64 start = get_current_us();
+                generate_region_visuals(&mesh_buffers, &bench_voxel_type_arrays[x][y][z], neighbor_voxel_types, &apron_edges, &lights, neighbor_lights, &render_info);
+                time += (us_t) (get_current_us() - start);
+
+                *num_mesh_bytes += get_region_visuals_num_bytes(&render_info);
+                free_region_visuals(&render_info);
+            }
+        }
+    }
+    return time;
+}
+
+// Same rays every round, from random points in the world in random directions
+static us_t raycast_bench_world(u32* num_hits) {
+    srand(1);
+    total_raycast_time = 0;
+    for (u32 i = 0; i < NUM_BENCH_RAYCASTS; i++) {
+        vec3s origin = {
+            .x = (f32) (bench_corner_region_pos.x * REGION_SIZE_X) + ((f32) rand() / (f32) RAND_MAX) * (f32) (BENCH_WORLD_SIZE_X * REGION_SIZE_X),
+            .y = (f32) (bench_corner_region_pos.y * REGION_SIZE_Y) + ((f32) rand() / (f32) RAND_MAX) * (f32) (BENCH_WORLD_SIZE_Y * REGION_SIZE_Y),
+            .z = (f32) (bench_corner_region_pos.z * REGION_SIZE_Z) + ((f32) rand() / (f32) RAND_MAX) * (f32) (BENCH_WORLD_SIZE_Z * REGION_SIZE_Z)
+        };
+        vec3s dir = glms_vec3_normalize((vec3s) {
+            .x = ((f32) rand() / (f32) RAND_MAX) - 0.5f,
+            .y = ((f32) rand() / (f32) RAND_MAX) - 0.5f,
+            .z = ((f32) rand() / (f32) RAND_MAX) - 0.5f
+        });
+        vec3s ray = glms_vec3_scale(dir, BENCH_RAYCAST_LENGTH);
+
+        voxel_raycast_wrap_t raycast = get_voxel_raycast(origin, ray, origin, glms_vec3_add(origin, ray), (vec3s) { .x = 0, .y = 0, .z = 0 }, voxel_box_type_selection);
+        if (raycast.success) {
+            (*num_hits)++;
+        }
+    }
+    return total_raycast_time;
+}
+
+int main(int, char**) {
+    init_display_list_pool();
+    init_region_mesh_cache();
+
+    us_t gen_time = 0;
+    us_t mesh_time = 0;
+    us_t raycast_time = 0;
+    size_t num_mesh_bytes = 0;
+    u32 num_hits = 0;
+    for (s32 round = 0; round < NUM_BENCH_ROUNDS; round++) {
+        bench_corner_region_pos = (s32vec3s) {{ round * BENCH_WORLD_SIZE_X, -1, 0 }};
+
+        gen_time += generate_bench_world();
+        mesh_time += mesh_bench_world(&num_mesh_bytes);
+        raycast_time += raycast_bench_world(&num_hits);
+    }
+
+    printf("Voxel layout: %s\nBGT: %d\nMGT: %d\nRCT: %d\nMesh bytes: %d\nRaycast hits: %d\n", VOXEL_LAYOUT_NAME, gen_time, mesh_time, raycast_time, (u32) num_mesh_bytes, num_hits);
+    return 0;
+}
\ No newline at end of file
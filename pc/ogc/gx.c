@@ -30,6 +30,7 @@ void GX_SetTexCoordGen(u16 texcoord, u32 tgen_typ, u32 tgen_src, u32 mtxsrc) {}
 void GX_ClearVtxDesc(void) {}
 void GX_SetVtxDesc(u8 attr, u8 type) {}
 void GX_SetVtxAttrFmt(u8 vtxfmt, u32 vtxattr, u32 comptype, u32 compsize, u32 frac) {}
+void GX_SetArray(u32 attr, void *ptr, u8 stride) {}
 
 static u32 inp_size;
 
@@ -42,7 +43,10 @@ void GX_Begin(u8 primitve, u8 vtxfmt, u16 vtxcnt) {}
 
 void GX_LoadPosMtxImm(f32 (*mt)[4], u32 pnidx) {}
 void GX_LoadTexObj(GXTexObj *obj, u8 mapid) {}
+void GX_InitTexObj(GXTexObj *obj, void *img_ptr, u16 wd, u16 ht, u8 fmt, u8 wrap_s, u8 wrap_t, u8 mipmap) {}
 void GX_InitTexObjFilterMode(GXTexObj *obj, u8 minfilt, u8 magfilt) {}
+void GX_InitTexObjWrapMode(GXTexObj *obj, u8 wrap_s, u8 wrap_t) {}
+void GX_LoadTexMtxImm(f32 (*mt)[4], u32 texidx, u8 type) {}
 void GX_SetCurrentMtx(u32 mtx) {}
 void GX_LoadProjectionMtx(f32 (*mt)[4], u8 type) {}
 void GX_SetBlendMode(u8 type, u8 src_fact, u8 dst_fact, u8 op) {}
@@ -0,0 +1,90 @@
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/semaphore.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Handles index into fixed tables, which is plenty for the few threads, semaphores and mutexes the game creates
+#define MAX_THREADS 8
+#define MAX_SEMAPHORES 8
+#define MAX_MUTEXES 8
+
+static pthread_t threads[MAX_THREADS];
+static u32 num_threads;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    u32 count;
+} semaphore_t;
+
+static semaphore_t semaphores[MAX_SEMAPHORES];
+static u32 num_semaphores;
+
+static pthread_mutex_t mutexes[MAX_MUTEXES];
+static u32 num_mutexes;
+
+s32 LWP_CreateThread(lwp_t *thethread, void* (*entry)(void *), void *arg, void *stackbase, u32 stack_size, u8 prio) {
+    if (num_threads == MAX_THREADS || pthread_create(&threads[num_threads], NULL, entry, arg) != 0) {
+        return -1;
+    }
+    *thethread = num_threads++;
+    return 0;
+}
+
+void LWP_YieldThread(void) {
+    sched_yield();
+}
+
+s32 LWP_SemInit(sem_t *sem, u32 start, u32 max) {
+    if (num_semaphores == MAX_SEMAPHORES) {
+        return -1;
+    }
+    semaphore_t* semaphore = &semaphores[num_semaphores];
+    pthread_mutex_init(&semaphore->mutex, NULL);
+    pthread_cond_init(&semaphore->cond, NULL);
+    semaphore->count = start;
+    *sem = num_semaphores++;
+    return 0;
+}
+
+s32 LWP_SemWait(sem_t sem) {
+    semaphore_t* semaphore = &semaphores[sem];
+    pthread_mutex_lock(&semaphore->mutex);
+    while (semaphore->count == 0) {
+        pthread_cond_wait(&semaphore->cond, &semaphore->mutex);
+    }
+    semaphore->count--;
+    pthread_mutex_unlock(&semaphore->mutex);
+    return 0;
+}
+
+s32 LWP_SemPost(sem_t sem) {
+    semaphore_t* semaphore = &semaphores[sem];
+    pthread_mutex_lock(&semaphore->mutex);
+    semaphore->count++;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->mutex);
+    return 0;
+}
+
+s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive) {
+    if (num_mutexes == MAX_MUTEXES) {
+        return -1;
+    }
+    // Recursive mutexes aren't used by the game
+    if (use_recursive) {
+        return -1;
+    }
+    pthread_mutex_init(&mutexes[num_mutexes], NULL);
+    *mutex = num_mutexes++;
+    return 0;
+}
+
+s32 LWP_MutexLock(mutex_t mutex) {
+    return pthread_mutex_lock(&mutexes[mutex]);
+}
+
+s32 LWP_MutexUnlock(mutex_t mutex) {
+    return pthread_mutex_unlock(&mutexes[mutex]);
+}
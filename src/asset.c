@@ -3,8 +3,11 @@
 #include "../build/textures_tpl.h"
 #include "../build/textures.h"
 #endif
+#include <ogc/cache.h>
 #include <ogc/gx.h>
+#include <ogc/system.h>
 #include <ogc/tpl.h>
+#include <string.h>
 
 alignas(32) static struct {
 	GXTexObj region;
@@ -13,6 +16,33 @@ alignas(32) static struct {
 	GXTexObj font;
 } textures;
 
+// RGBA8 textures are stored in blocks of 4x4 texels, 64 bytes each, row by row
+#define RGBA8_BLOCK_SIZE 4
+#define RGBA8_BLOCK_NUM_BYTES 64
+#define REGION_TILE_BLOCK_ROW_NUM_BYTES ((REGION_TEXTURE_TILE_SIZE / RGBA8_BLOCK_SIZE) * RGBA8_BLOCK_NUM_BYTES)
+
+alignas(32) static u8 region_tile_texture_data[NUM_REGION_TEXTURE_TILES][REGION_TEXTURE_TILE_SIZE * REGION_TEXTURE_TILE_SIZE * 4];
+alignas(32) static GXTexObj region_tile_textures[NUM_REGION_TEXTURE_TILES];
+
+// A tile's blocks are strided through the atlas, so each block row is copied out into a texture of its own
+static void init_region_tile_textures(void) {
+    #ifndef PC_PORT
+    const u8* atlas_data = MEM_PHYSICAL_TO_K0(GX_GetTexObjData(&textures.region));
+    size_t atlas_block_row_num_bytes = (GX_GetTexObjWidth(&textures.region) / RGBA8_BLOCK_SIZE) * RGBA8_BLOCK_NUM_BYTES;
+    for (size_t tile = 0; tile < NUM_REGION_TEXTURE_TILES; tile++) {
+        for (size_t row = 0; row < REGION_TEXTURE_TILE_SIZE / RGBA8_BLOCK_SIZE; row++) {
+            memcpy(&region_tile_texture_data[tile][row * REGION_TILE_BLOCK_ROW_NUM_BYTES], &atlas_data[(row * atlas_block_row_num_bytes) + (tile * REGION_TILE_BLOCK_ROW_NUM_BYTES)], REGION_TILE_BLOCK_ROW_NUM_BYTES);
+        }
+    }
+    DCFlushRange(region_tile_texture_data, sizeof(region_tile_texture_data));
+    #endif
+
+    for (size_t tile = 0; tile < NUM_REGION_TEXTURE_TILES; tile++) {
+        GX_InitTexObj(&region_tile_textures[tile], region_tile_texture_data[tile], REGION_TEXTURE_TILE_SIZE, REGION_TEXTURE_TILE_SIZE, GX_TF_RGBA8, GX_REPEAT, GX_REPEAT, GX_FALSE);
+        GX_InitTexObjFilterMode(&region_tile_textures[tile], GX_NEAR, GX_NEAR);
+    }
+}
+
 void asset_init(void) {
     #ifndef PC_PORT
     TPLFile file;
@@ -25,6 +55,8 @@ void asset_init(void) {
     #endif
 
 	GX_InitTexObjFilterMode(&textures.region, GX_NEAR, GX_NEAR);
+	// The region texture atlas is a single row of tiles, so merged region faces repeat their texture along t
+	GX_InitTexObjWrapMode(&textures.region, GX_CLAMP, GX_REPEAT);
 	GX_InitTexObjFilterMode(&textures.icons, GX_NEAR, GX_NEAR);
 	GX_InitTexObjFilterMode(&textures.font, GX_NEAR, GX_NEAR);
 
@@ -32,4 +64,14 @@ void asset_init(void) {
 	GX_LoadTexObj(&textures.icons, GX_TEXMAP1);
 	GX_LoadTexObj(&textures.skybox, GX_TEXMAP2);
 	GX_LoadTexObj(&textures.font, GX_TEXMAP3);
+
+	init_region_tile_textures();
+}
+
+void load_region_texture(void) {
+	GX_LoadTexObj(&textures.region, GX_TEXMAP0);
+}
+
+void load_region_tile_texture(u8 tile) {
+	GX_LoadTexObj(&region_tile_textures[tile], GX_TEXMAP0);
 }
\ No newline at end of file
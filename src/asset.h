@@ -1,3 +1,13 @@
 #pragma once
+#include <gctypes.h>
 
-void asset_init(void);
\ No newline at end of file
+// The region texture is an atlas of square tiles in a single row
+#define REGION_TEXTURE_TILE_SIZE 16
+#define NUM_REGION_TEXTURE_TILES 16
+
+void asset_init(void);
+
+// Loads the region texture atlas into GX_TEXMAP0
+void load_region_texture(void);
+// Loads a copy of a single tile of the region texture atlas into GX_TEXMAP0, which repeats along both axes
+void load_region_tile_texture(u8 tile);
\ No newline at end of file
@@ -5,6 +5,7 @@
 us_t total_procedural_gen_time = 0;
 us_t total_visual_gen_time = 0;
 us_t last_visual_gen_time = 0;
+us_t total_raycast_time = 0;
 
 s64 get_current_us() {
     struct timeval cur_time;
@@ -6,5 +6,6 @@ typedef u32 us_t;
 extern us_t total_procedural_gen_time;
 extern us_t total_visual_gen_time;
 extern us_t last_visual_gen_time;
+extern us_t total_raycast_time;
 
 s64 get_current_us();
\ No newline at end of file
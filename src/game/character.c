@@ -158,7 +158,7 @@ void character_handle_input(vec3w_t last_wpad_accel, vec3w_t last_nunchuk_accel,
 void character_apply_physics(f32 delta) {
     #ifndef PC_PORT
     // Check if there is a valid voxel at the character's position
-    if (get_voxel_type_from_voxel_world_position(get_voxel_world_position(character_position)) == NULL) {
+    if (!get_voxel_type_from_voxel_world_position(get_voxel_world_position(character_position)).success) {
         character_velocity.y = 0.0f;
         return;
     }
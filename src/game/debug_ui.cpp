@@ -11,6 +11,10 @@ extern "C" {
 
 extern vec3s character_position;
 extern vec3s cam_forward;
+extern u32 num_drawn_regions;
+extern u32 num_culled_regions;
+extern u32 num_bytes_per_region[];
+extern bool region_stats_enabled;
 
 using namespace game;
 
@@ -31,6 +35,8 @@ debug_ui::debug_ui() {
     write_text(bgt_prefix_disp_list, bgt_prefix, 3);
     write_text(mgt_prefix_disp_list, mgt_prefix, 4);
     write_text(mgl_prefix_disp_list, mgl_prefix, 5);
+    write_text(cul_prefix_disp_list, cul_prefix, 6);
+    write_text(bpr_prefix_disp_list, bpr_prefix, 7);
 }
 
 static inline std::string to_string(const glm::vec3& v) {
@@ -42,10 +48,11 @@ static inline std::string to_string(const glm::vec3& v) {
 void debug_ui::update(u32 buttons_down) {
     if (buttons_down & WPAD_BUTTON_2) {
         draw_extra_info = !draw_extra_info;
+        region_stats_enabled = draw_extra_info;
     }
 }
 
-void debug_ui::draw(const glm::vec3& pos, const glm::vec3& dir, us_t total_procedural_gen_time, us_t total_visual_gen_time, us_t last_visual_gen_time, u32 fps) const {
+void debug_ui::draw(const glm::vec3& pos, const glm::vec3& dir, us_t total_procedural_gen_time, us_t total_visual_gen_time, us_t last_visual_gen_time, u32 num_drawn_regions, u32 num_culled_regions, const u32* num_bytes_per_region, u32 fps) const {
     constexpr auto write_text = [](std::string_view str, u16 y_offset) {
         gfx::write_text_vertices<u8>([y_offset](u16 x, u16 y, u8 u, u8 v) {
             GX_Position2u16(x + prefix_width, y + (char_size * y_offset));
@@ -64,13 +71,19 @@ void debug_ui::draw(const glm::vec3& pos, const glm::vec3& dir, us_t total_proce
         bgt_prefix_disp_list.call();
         mgt_prefix_disp_list.call();
         mgl_prefix_disp_list.call();
+        cul_prefix_disp_list.call();
+        bpr_prefix_disp_list.call();
 
         auto pos_str = to_string(pos);
         auto dir_str = to_string(dir);
         auto total_procedural_gen_time_str = std::to_string(total_procedural_gen_time);
         auto total_visual_gen_time_str = std::to_string(total_visual_gen_time);
         auto last_visual_gen_time_str = std::to_string(last_visual_gen_time);
-        std::size_t num_vertices = 4 * (fps_str.size() + pos_str.size() + dir_str.size() + total_procedural_gen_time_str.size() + total_visual_gen_time_str.size() + last_visual_gen_time_str.size());
+        // Drawn and culled regions
+        auto cull_str = std::to_string(num_drawn_regions) + ' ' + std::to_string(num_culled_regions);
+        // Bytes per region meshed with the direct, indexed and tex gen vertex formats
+        auto bpr_str = std::to_string(num_bytes_per_region[0]) + ' ' + std::to_string(num_bytes_per_region[1]) + ' ' + std::to_string(num_bytes_per_region[2]);
+        std::size_t num_vertices = 4 * (fps_str.size() + pos_str.size() + dir_str.size() + total_procedural_gen_time_str.size() + total_visual_gen_time_str.size() + last_visual_gen_time_str.size() + cull_str.size() + bpr_str.size());
 
         GX_Begin(GX_QUADS, GX_VTXFMT2, num_vertices);
 
@@ -80,6 +93,8 @@ void debug_ui::draw(const glm::vec3& pos, const glm::vec3& dir, us_t total_proce
         write_text(total_procedural_gen_time_str, 3);
         write_text(total_visual_gen_time_str, 4);
         write_text(last_visual_gen_time_str, 5);
+        write_text(cull_str, 6);
+        write_text(bpr_str, 7);
 
         GX_End();
     } else {
@@ -103,5 +118,5 @@ void debug_ui_update(u32 buttons_down) {
 }
 
 void debug_ui_draw(us_t total_procedural_gen_time, us_t total_visual_gen_time, us_t last_visual_gen_time, u32 fps) {
-    ui->draw({ character_position.raw[0], character_position.raw[1], character_position.raw[2] }, { cam_forward.raw[0], cam_forward.raw[1], cam_forward.raw[2] }, total_procedural_gen_time, total_visual_gen_time, last_visual_gen_time, fps);
+    ui->draw({ character_position.raw[0], character_position.raw[1], character_position.raw[2] }, { cam_forward.raw[0], cam_forward.raw[1], cam_forward.raw[2] }, total_procedural_gen_time, total_visual_gen_time, last_visual_gen_time, num_drawn_regions, num_culled_regions, num_bytes_per_region, fps);
 }
\ No newline at end of file
@@ -13,6 +13,8 @@ namespace game {
         static constexpr const char* bgt_prefix = "BGT: ";
         static constexpr const char* mgt_prefix = "MGT: ";
         static constexpr const char* mgl_prefix = "MGL: ";
+        static constexpr const char* cul_prefix = "CUL: ";
+        static constexpr const char* bpr_prefix = "BPR: ";
         static constexpr u16 char_size = 16;
         static constexpr u16 prefix_width = gfx::get_text_width(fps_prefix, char_size);
 
@@ -23,12 +25,14 @@ namespace game {
         gfx::display_list bgt_prefix_disp_list;
         gfx::display_list mgt_prefix_disp_list;
         gfx::display_list mgl_prefix_disp_list;
+        gfx::display_list cul_prefix_disp_list;
+        gfx::display_list bpr_prefix_disp_list;
 
         bool draw_extra_info = false;
 
         debug_ui();
 
         void update(u32 buttons_down);
-        void draw(const glm::vec3& pos, const glm::vec3& dir, us_t total_procedural_gen_time, us_t total_visual_gen_time, us_t last_visual_gen_time, u32 fps) const;
+        void draw(const glm::vec3& pos, const glm::vec3& dir, us_t total_procedural_gen_time, us_t total_visual_gen_time, us_t last_visual_gen_time, u32 num_drawn_regions, u32 num_culled_regions, const u32* num_bytes_per_region, u32 fps) const;
     };
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <gctypes.h>
 
 typedef struct {
-    u16 num_bytes;
+    u32 num_bytes;
     const void* data;
+    // Texture tile and voxel_face_t whose texture coordinates are generated for the display list, only used by region_vertex_format_tex_gen
+    u8 tex_gen_tile;
+    u8 tex_gen_face;
 } display_list_t;
\ No newline at end of file
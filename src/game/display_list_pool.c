@@ -0,0 +1,108 @@
+#include "display_list_pool.h"
+#include "log.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <ogc/mutex.h>
+
+// Size classes are powers of two from 32 bytes to 64 KB, larger display lists bypass the pool
+#define MIN_SIZE_CLASS_BYTES 32
+#define NUM_SIZE_CLASSES 12
+
+static size_t get_size_class_num_bytes(size_t size_class) {
+    return (size_t) MIN_SIZE_CLASS_BYTES << size_class;
+}
+
+// Returns NUM_SIZE_CLASSES if num_bytes is too large for any size class
+static size_t get_size_class(size_t num_bytes) {
+    size_t size_class = 0;
+    while (size_class < NUM_SIZE_CLASSES && get_size_class_num_bytes(size_class) < num_bytes) {
+        size_class++;
+    }
+    return size_class;
+}
+
+// Freed display lists are linked through their first bytes
+typedef struct free_display_list {
+    struct free_display_list* next;
+} free_display_list_t;
+
+static free_display_list_t* free_display_lists[NUM_SIZE_CLASSES];
+
+static display_list_pool_stats_t stats;
+
+// Display lists are allocated on the region worker and freed on the main thread
+static mutex_t pool_mutex;
+
+void init_display_list_pool(void) {
+    LWP_MutexInit(&pool_mutex, false);
+}
+
+void* alloc_display_list(size_t num_bytes) {
+    size_t size_class = get_size_class(num_bytes);
+    size_t num_reserved_bytes = size_class == NUM_SIZE_CLASSES ? num_bytes : get_size_class_num_bytes(size_class);
+
+    LWP_MutexLock(pool_mutex);
+
+    void* data = NULL;
+    if (size_class < NUM_SIZE_CLASSES && free_display_lists[size_class] != NULL) {
+        free_display_list_t* free_display_list = free_display_lists[size_class];
+        free_display_lists[size_class] = free_display_list->next;
+        stats.num_free_bytes -= num_reserved_bytes;
+        data = free_display_list;
+    }
+
+    stats.num_used_bytes += num_bytes;
+    stats.num_reserved_bytes += num_reserved_bytes;
+    stats.num_display_lists++;
+
+    LWP_MutexUnlock(pool_mutex);
+
+    if (data == NULL) {
+        data = memalign(32, num_reserved_bytes);
+    }
+    return data;
+}
+
+void free_display_list(void* data, size_t num_bytes) {
+    size_t size_class = get_size_class(num_bytes);
+    size_t num_reserved_bytes = size_class == NUM_SIZE_CLASSES ? num_bytes : get_size_class_num_bytes(size_class);
+
+    LWP_MutexLock(pool_mutex);
+
+    stats.num_used_bytes -= num_bytes;
+    stats.num_reserved_bytes -= num_reserved_bytes;
+    stats.num_display_lists--;
+
+    if (size_class < NUM_SIZE_CLASSES) {
+        free_display_list_t* free_display_list = data;
+        free_display_list->next = free_display_lists[size_class];
+        free_display_lists[size_class] = free_display_list;
+        stats.num_free_bytes += num_reserved_bytes;
+        data = NULL;
+    }
+
+    LWP_MutexUnlock(pool_mutex);
+
+    free(data);
+}
+
+display_list_pool_stats_t get_display_list_pool_stats(void) {
+    LWP_MutexLock(pool_mutex);
+    display_list_pool_stats_t pool_stats = stats;
+    LWP_MutexUnlock(pool_mutex);
+    return pool_stats;
+}
+
+void log_display_list_pool_stats(void) {
+    display_list_pool_stats_t pool_stats = get_display_list_pool_stats();
+    size_t num_total_bytes = pool_stats.num_reserved_bytes + pool_stats.num_free_bytes;
+    // Fragmentation is the share of the pool's memory that holds no display list data
+    u32 fragmentation_percent = num_total_bytes == 0 ? 0 : (u32) (((num_total_bytes - pool_stats.num_used_bytes) * 100) / num_total_bytes);
+    lprintf("Num display lists: %d\nDisplay list bytes used: %d\nDisplay list bytes reserved: %d\nDisplay list bytes free: %d\nDisplay list fragmentation: %d%%\n",
+        (u32) pool_stats.num_display_lists,
+        (u32) pool_stats.num_used_bytes,
+        (u32) pool_stats.num_reserved_bytes,
+        (u32) pool_stats.num_free_bytes,
+        fragmentation_percent
+    );
+}
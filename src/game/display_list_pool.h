@@ -0,0 +1,24 @@
+#pragma once
+#include <gctypes.h>
+#include <stddef.h>
+
+typedef struct {
+    // Bytes the live display lists asked for
+    size_t num_used_bytes;
+    // Bytes held by live display lists, the difference to num_used_bytes is lost to size class rounding
+    size_t num_reserved_bytes;
+    // Bytes of freed display lists kept for reuse
+    size_t num_free_bytes;
+    size_t num_display_lists;
+} display_list_pool_stats_t;
+
+// Must be called before any display list is allocated
+void init_display_list_pool(void);
+// Returns 32 byte aligned memory with room for num_bytes, which is expected to be a multiple of 32.
+// Safe to call from any thread.
+void* alloc_display_list(size_t num_bytes);
+// num_bytes must be the same as when the display list was allocated. Safe to call from any thread.
+void free_display_list(void* data, size_t num_bytes);
+
+display_list_pool_stats_t get_display_list_pool_stats(void);
+void log_display_list_pool_stats(void);
@@ -8,10 +8,9 @@
 #include <ogc/lwp_queue.h>
 #include <wiiuse/wpad.h>
 
-void update_world(const voxel_raycast_t* raycast, u32 buttons_down) {
+void update_world(const voxel_raycast_t* raycast, u32 buttons_down, u8 nunchuk_buttons) {
     if (buttons_down & WPAD_BUTTON_A) {
-        *get_voxel_type_from_voxel_world_position(raycast->voxel_world_pos) = voxel_type_air;
-        // update_block_chunk_and_neighbors(region_pos, location.region_pos, location.voxel_local_pos);
+        set_voxel_type_at_voxel_world_position(raycast->voxel_world_pos, voxel_type_air);
     }
     if (buttons_down & WPAD_BUTTON_B) {
         s32vec3s voxel_world_pos = raycast->voxel_world_pos;
@@ -19,11 +18,6 @@ void update_world(const voxel_raycast_t* raycast, u32 buttons_down) {
         voxel_world_pos.y += (s32) raycast->box_raycast.normal.y;
         voxel_world_pos.z += (s32) raycast->box_raycast.normal.z;
 
-        voxel_type_t* voxel_type = get_voxel_type_from_voxel_world_position(voxel_world_pos);
-        if (voxel_type == NULL) {
-            return;
-        }
-
-        *voxel_type = voxel_type_wood_planks;
+        set_voxel_type_at_voxel_world_position(voxel_world_pos, (nunchuk_buttons & NUNCHUK_BUTTON_Z) ? voxel_type_glowstone : voxel_type_wood_planks);
     }
 }
\ No newline at end of file
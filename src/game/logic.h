@@ -3,4 +3,5 @@
 #include <cglm/struct/mat4.h>
 #include <gctypes.h>
 
-void update_world(const voxel_raycast_t* raycast, u32 buttons_down);
\ No newline at end of file
+// B places wood planks, or glowstone while the nunchuk's Z button is held
+void update_world(const voxel_raycast_t* raycast, u32 buttons_down, u8 nunchuk_buttons);
\ No newline at end of file
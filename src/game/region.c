@@ -1,7 +1,230 @@
 #include "region.h"
 #include "game_math.h"
 #include "util.h"
+#include <stdlib.h>
+#include <string.h>
 
 s32vec3s get_region_position_from_voxel_world_position(s32vec3s voxel_world_pos) {
-	return (s32vec3s) {{ div_s32(voxel_world_pos.x, REGION_SIZE), div_s32(voxel_world_pos.y, REGION_SIZE), div_s32(voxel_world_pos.z, REGION_SIZE) }};
+	return (s32vec3s) {{ div_s32(voxel_world_pos.x, REGION_SIZE_X), div_s32(voxel_world_pos.y, REGION_SIZE_Y), div_s32(voxel_world_pos.z, REGION_SIZE_Z) }};
+}
+
+static u8 get_num_bits_per_voxel(size_t num_palette_entries) {
+    if (num_palette_entries <= 1) {
+        return 0;
+    }
+    if (num_palette_entries <= 2) {
+        return 1;
+    }
+    if (num_palette_entries <= 4) {
+        return 2;
+    }
+    if (num_palette_entries <= NUM_VOXEL_TYPE_PALETTE_ENTRIES) {
+        return 4;
+    }
+    return 8;
+}
+
+static void write_palette_index(u8* data, u8 bits_per_voxel, size_t index, u8 palette_index) {
+    size_t bit_index = index * bits_per_voxel;
+    u8 mask = (u8) (((1u << bits_per_voxel) - 1u) << (bit_index % 8));
+    data[bit_index / 8] = (u8) ((data[bit_index / 8] & ~mask) | ((u32) palette_index << (bit_index % 8)));
+}
+
+size_t get_voxel_type_array_num_bytes(const voxel_type_array_t* voxel_types) {
+    return ((NUM_REGION_VOXELS * (size_t) voxel_types->bits_per_voxel) + 7) / 8;
+}
+
+void copy_voxel_types_from_array(const voxel_type_array_t* voxel_types, voxel_type_t types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z]) {
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                types[x][y][z] = get_voxel_type_from_array(voxel_types, x, y, z);
+            }
+        }
+    }
+}
+
+void init_voxel_type_array(voxel_type_array_t* voxel_types, const voxel_type_t types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z]) {
+    const voxel_type_t* flat_types = &types[0][0][0];
+
+    // Maps a voxel type to its palette index, or to 0xffff if it is not in the palette yet
+    u16 palette_indices[256];
+    memset(palette_indices, 0xff, sizeof(palette_indices));
+
+    size_t num_palette_entries = 0;
+    for (size_t i = 0; i < NUM_REGION_VOXELS; i++) {
+        voxel_type_t type = flat_types[i];
+        if (palette_indices[type] != 0xffff) {
+            continue;
+        }
+        if (num_palette_entries < NUM_VOXEL_TYPE_PALETTE_ENTRIES) {
+            voxel_types->palette[num_palette_entries] = type;
+        }
+        palette_indices[type] = (u16) num_palette_entries++;
+    }
+
+    u8 bits_per_voxel = get_num_bits_per_voxel(num_palette_entries);
+    voxel_types->bits_per_voxel = bits_per_voxel;
+    voxel_types->num_palette_entries = bits_per_voxel == 8 ? 0 : (u8) num_palette_entries;
+
+    free(voxel_types->data);
+    voxel_types->data = NULL;
+    if (bits_per_voxel == 0) {
+        return;
+    }
+
+    size_t num_bytes = get_voxel_type_array_num_bytes(voxel_types);
+    voxel_types->data = malloc(num_bytes);
+
+    #if VOXEL_LAYOUT == VOXEL_LAYOUT_XYZ
+    if (bits_per_voxel == 8) {
+        memcpy(voxel_types->data, flat_types, num_bytes);
+        return;
+    }
+    #endif
+
+    memset(voxel_types->data, 0, num_bytes);
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                voxel_type_t type = types[x][y][z];
+                size_t index = get_voxel_index(x, y, z);
+                if (bits_per_voxel == 8) {
+                    voxel_types->data[index] = type;
+                } else {
+                    write_palette_index(voxel_types->data, bits_per_voxel, index, (u8) palette_indices[type]);
+                }
+            }
+        }
+    }
+}
+
+void init_uniform_voxel_type_array(voxel_type_array_t* voxel_types, voxel_type_t type) {
+    free(voxel_types->data);
+    voxel_types->data = NULL;
+    voxel_types->bits_per_voxel = 0;
+    voxel_types->num_palette_entries = 1;
+    voxel_types->palette[0] = type;
+}
+
+void copy_voxel_type_array(voxel_type_array_t* dest, const voxel_type_array_t* src) {
+    free(dest->data);
+    *dest = *src;
+    if (is_voxel_type_array_uniform(src)) {
+        return;
+    }
+
+    size_t num_bytes = get_voxel_type_array_num_bytes(src);
+    dest->data = malloc(num_bytes);
+    memcpy(dest->data, src->data, num_bytes);
+}
+
+void free_voxel_type_array(voxel_type_array_t* voxel_types) {
+    init_uniform_voxel_type_array(voxel_types, voxel_type_air);
+}
+
+void set_voxel_type_in_array(voxel_type_array_t* voxel_types, u32 x, u32 y, u32 z, voxel_type_t type) {
+    size_t index = get_voxel_index(x, y, z);
+    if (is_voxel_type_array_uniform(voxel_types)) {
+        if (voxel_types->palette[0] == type) {
+            return;
+        }
+        voxel_types->bits_per_voxel = 1;
+        voxel_types->num_palette_entries = 2;
+        voxel_types->palette[1] = type;
+
+        size_t num_bytes = get_voxel_type_array_num_bytes(voxel_types);
+        voxel_types->data = malloc(num_bytes);
+        memset(voxel_types->data, 0, num_bytes);
+        write_palette_index(voxel_types->data, voxel_types->bits_per_voxel, index, 1);
+        return;
+    }
+    if (voxel_types->bits_per_voxel == 8) {
+        voxel_types->data[index] = type;
+        return;
+    }
+
+    for (u8 i = 0; i < voxel_types->num_palette_entries; i++) {
+        if (voxel_types->palette[i] == type) {
+            write_palette_index(voxel_types->data, voxel_types->bits_per_voxel, index, i);
+            return;
+        }
+    }
+
+    if (voxel_types->num_palette_entries < (1u << voxel_types->bits_per_voxel)) {
+        u8 palette_index = voxel_types->num_palette_entries++;
+        voxel_types->palette[palette_index] = type;
+        write_palette_index(voxel_types->data, voxel_types->bits_per_voxel, index, palette_index);
+        return;
+    }
+
+    // The palette is full so repack with more bits per voxel
+    voxel_type_t types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z];
+    copy_voxel_types_from_array(voxel_types, types);
+    types[x][y][z] = type;
+    init_voxel_type_array(voxel_types, types);
+}
+
+size_t get_voxel_light_array_num_bytes(const voxel_light_array_t* lights) {
+    return lights->data == NULL ? 0 : NUM_REGION_VOXELS * sizeof(*lights->data);
+}
+
+void init_voxel_light_array(voxel_light_array_t* lights, const voxel_light_t uncompressed_lights[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z]) {
+    const voxel_light_t* flat_lights = &uncompressed_lights[0][0][0];
+
+    free(lights->data);
+    lights->data = NULL;
+    lights->uniform_light = flat_lights[0];
+
+    bool uniform = true;
+    for (size_t i = 1; i < NUM_REGION_VOXELS; i++) {
+        if (flat_lights[i] != flat_lights[0]) {
+            uniform = false;
+            break;
+        }
+    }
+    if (uniform) {
+        return;
+    }
+
+    lights->data = malloc(NUM_REGION_VOXELS * sizeof(*lights->data));
+    #if VOXEL_LAYOUT == VOXEL_LAYOUT_XYZ
+    memcpy(lights->data, flat_lights, NUM_REGION_VOXELS * sizeof(*lights->data));
+    #else
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                lights->data[get_voxel_index(x, y, z)] = uncompressed_lights[x][y][z];
+            }
+        }
+    }
+    #endif
+}
+
+void copy_voxel_light_array(voxel_light_array_t* dest, const voxel_light_array_t* src) {
+    free(dest->data);
+    *dest = *src;
+    if (src->data == NULL) {
+        return;
+    }
+
+    dest->data = malloc(NUM_REGION_VOXELS * sizeof(*dest->data));
+    memcpy(dest->data, src->data, NUM_REGION_VOXELS * sizeof(*dest->data));
+}
+
+void free_voxel_light_array(voxel_light_array_t* lights) {
+    free(lights->data);
+    lights->data = NULL;
+    lights->uniform_light = 0;
+}
+
+void set_voxel_light_in_array(voxel_light_array_t* lights, u32 x, u32 y, u32 z, voxel_light_t light) {
+    if (lights->data == NULL) {
+        if (lights->uniform_light == light) {
+            return;
+        }
+        lights->data = malloc(NUM_REGION_VOXELS * sizeof(*lights->data));
+        memset(lights->data, lights->uniform_light, NUM_REGION_VOXELS * sizeof(*lights->data));
+    }
+    lights->data[get_voxel_index(x, y, z)] = light;
 }
\ No newline at end of file
@@ -6,33 +6,248 @@
 #include <gctypes.h>
 #include <stddef.h>
 
-#define REGION_SIZE 16
+// Region dimensions in voxels. Each can be overridden at compile time to compare draw call counts against remesh costs,
+// e.g. make XFLAGS="-DREGION_SIZE_Y=64" for tall columns, or make -f pc.mk region_size_variants to build several side by side.
+#ifndef REGION_SIZE_X
+#define REGION_SIZE_X 16
+#endif
+#ifndef REGION_SIZE_Y
+#define REGION_SIZE_Y 16
+#endif
+#ifndef REGION_SIZE_Z
+#define REGION_SIZE_Z 16
+#endif
 
-#define NUM_REGION_DISPLAY_LIST_ARRAYS 3
+#define MAX_REGION_SIZE (REGION_SIZE_X > REGION_SIZE_Y ? (REGION_SIZE_X > REGION_SIZE_Z ? REGION_SIZE_X : REGION_SIZE_Z) : (REGION_SIZE_Y > REGION_SIZE_Z ? REGION_SIZE_Y : REGION_SIZE_Z))
+
+// Mesh positions are u8 in voxels with REGION_POSITION_FRAC_BITS fractional bits, bigger regions trade the fractional bits for range
+#if MAX_REGION_SIZE * 4 <= 0xff
+#define REGION_POSITION_FRAC_BITS 2
+#elif MAX_REGION_SIZE * 2 <= 0xff
+#define REGION_POSITION_FRAC_BITS 1
+#elif MAX_REGION_SIZE <= 0xff
+#define REGION_POSITION_FRAC_BITS 0
+#else
+#error "Mesh positions don't fit in a u8"
+#endif
+
+#define REGION_POSITION_SCALE (1 << REGION_POSITION_FRAC_BITS)
+
+// Solid faces are bucketed by direction, ordered by voxel_face_t, so that the buckets facing away from the camera can be skipped
+#define REGION_SOLID_DISPLAY_LIST_ARRAYS_INDEX 0
+#define REGION_TRANSPARENT_DISPLAY_LIST_ARRAY_INDEX 6
+#define REGION_CROSS_DISPLAY_LIST_ARRAY_INDEX 7
+#define NUM_REGION_DISPLAY_LIST_ARRAYS 8
+
+typedef enum __attribute__((__packed__)) {
+    // Display lists hold every vertex's position, shades and texture coordinate
+    region_vertex_format_direct,
+    // Display lists hold GX_INDEX8 or GX_INDEX16 indices into arrays of the region's unique positions and texture coordinates, along with every vertex's shades
+    region_vertex_format_indexed,
+    // Display lists hold only positions and shades, texture coordinates are generated from them with a texture matrix per face and a texture per tile.
+    // Quads are grouped into a display list per face and tile.
+    region_vertex_format_tex_gen
+} region_vertex_format_t;
+
+#define NUM_REGION_VERTEX_FORMATS 3
+
+// Light levels go from 0 in darkness up to MAX_LIGHT_LEVEL, for both sky light and block light
+#define NUM_LIGHT_LEVELS 16
+#define MAX_LIGHT_LEVEL (NUM_LIGHT_LEVELS - 1)
+
+// Every vertex has a sky shade and a block shade that index the colors its texture is lit by.
+// Shades are baked from the ambient occlusion of the vertex and the light of the voxel in front of its face when the region is meshed,
+// a shade is its ambient occlusion times NUM_LIGHT_LEVELS plus its light level.
+#define NUM_REGION_AO_LEVELS 4
+#define NUM_REGION_SHADES (NUM_REGION_AO_LEVELS * NUM_LIGHT_LEVELS)
+
+// Cross meshes aren't aligned with any voxel face, so they get their own texture matrix after the ones of the faces
+#define CROSS_TEX_GEN_FACE 6
 
 typedef struct {
     size_t num_display_lists;
     display_list_t* display_lists;
 } region_display_list_array_t;
 
+// Arrays that the display lists of a region meshed with region_vertex_format_indexed index into
+typedef struct {
+    // Unique positions, followed by the unique texture coordinates at tex_coords_offset. NULL if the display lists hold their vertices directly.
+    u8* data;
+    u32 num_bytes;
+    u32 tex_coords_offset;
+    // GX_INDEX8 or GX_INDEX16
+    u8 position_index_type;
+    u8 tex_coord_index_type;
+} region_vertex_arrays_t;
+
+typedef struct region_mesh_cache_entry region_mesh_cache_entry_t;
+
 typedef struct {
     region_display_list_array_t display_list_arrays[NUM_REGION_DISPLAY_LIST_ARRAYS];
+    region_vertex_format_t vertex_format;
+    region_vertex_arrays_t vertex_arrays;
+    // The cached mesh that the display lists and vertex arrays belong to, NULL if they aren't cached
+    region_mesh_cache_entry_t* mesh_cache_entry;
+} region_mesh_t;
+
+// Level of detail 0 is meshed from the region's voxels, every further level from cells of 2x2x2 voxels of the level before
+#define NUM_REGION_LODS 3
+
+static_assert(REGION_SIZE_X % (1 << (NUM_REGION_LODS - 1)) == 0 && REGION_SIZE_Y % (1 << (NUM_REGION_LODS - 1)) == 0 && REGION_SIZE_Z % (1 << (NUM_REGION_LODS - 1)) == 0, "Regions can't be downsampled to every level of detail");
+
+typedef struct {
+    // Indexed by level of detail, only the first num_lod_meshes are meshed
+    region_mesh_t lod_meshes[NUM_REGION_LODS];
+    // Uniform regions only get level 0, which has no more quads than a downsampled mesh would
+    u8 num_lod_meshes;
+    // For each region face, a bitmask of the region faces that can be seen from it through non-opaque voxels, both ordered by voxel_face_t
+    u8 face_connections[6];
 } region_render_info_t;
 
+#define ALL_REGION_FACES_CONNECTED 0x3f
+
+#define NUM_REGION_VOXELS (REGION_SIZE_X * REGION_SIZE_Y * REGION_SIZE_Z)
+
+#define NUM_VOXEL_TYPE_PALETTE_ENTRIES 16
+
+// Palette compressed voxel types, packed in the order given by get_voxel_index.
+// Each voxel stores an index into the palette using 1, 2 or 4 bits depending on how many different types the region holds.
+// Once a region needs more than NUM_VOXEL_TYPE_PALETTE_ENTRIES types it is promoted to 8 bits per voxel, which stores the types directly.
+// A uniform region uses 0 bits per voxel, allocates no data and holds its only type in palette[0].
 typedef struct {
-    // types[x][y][z]
-    voxel_type_t types[REGION_SIZE][REGION_SIZE][REGION_SIZE];
+    u8* data;
+    u8 bits_per_voxel;
+    u8 num_palette_entries;
+    voxel_type_t palette[NUM_VOXEL_TYPE_PALETTE_ENTRIES];
 } voxel_type_array_t;
 
-extern u32 world_size;
-extern voxel_type_array_t** region_voxel_type_arrays;
+// A voxel's sky light in the high nibble and its block light in the low nibble.
+// They are kept apart so that the sky can be tinted, e.g. for the time of day, without meshing the regions again.
+typedef u8 voxel_light_t;
+
+// Light of every voxel of a region in the order given by get_voxel_index.
+// Regions that are lit the same everywhere, like those in the open sky or deep underground, allocate no data and hold their light in uniform_light.
+typedef struct {
+    voxel_light_t* data;
+    voxel_light_t uniform_light;
+} voxel_light_array_t;
+
+// Number of regions loaded along each axis
+extern u32vec3s world_size;
+extern voxel_type_array_t* region_voxel_type_arrays;
+extern voxel_light_array_t* region_voxel_light_arrays;
 extern region_render_info_t* region_render_infos;
 
 inline size_t get_num_regions() {
-    return world_size * world_size * world_size;
+    return world_size.x * world_size.y * world_size.z;
+}
+
+#define REGION_TYPE_3D(TYPE) typeof(TYPE (*)[world_size.x][world_size.y][world_size.z]) 
+#define REGION_CAST_3D(TYPE, VAR) (TYPE (*)[world_size.x][world_size.y][world_size.z]) (VAR)
+
+s32vec3s get_region_position_from_voxel_world_position(s32vec3s voxel_world_pos);
+
+// Orders in which voxel_type_array_t packs its voxels, picked at compile time with e.g. make XFLAGS=-DVOXEL_LAYOUT=VOXEL_LAYOUT_MORTON.
+// The layout is logged along with the generation, meshing and raycast times (BGT, MGT, RCT), make -f pc.mk voxel_layout_bench compares them on a fixed world.
+// Linear [x][y][z], z is contiguous
+#define VOXEL_LAYOUT_XYZ 0
+// Linear [y][x][z], horizontal slices are contiguous
+#define VOXEL_LAYOUT_YXZ 1
+// Morton (Z-order), every aligned 2x2x2, 4x4x4, ... block is contiguous
+#define VOXEL_LAYOUT_MORTON 2
+
+#ifndef VOXEL_LAYOUT
+#define VOXEL_LAYOUT VOXEL_LAYOUT_XYZ
+#endif
+
+#if VOXEL_LAYOUT == VOXEL_LAYOUT_XYZ
+#define VOXEL_LAYOUT_NAME "xyz"
+#elif VOXEL_LAYOUT == VOXEL_LAYOUT_YXZ
+#define VOXEL_LAYOUT_NAME "yxz"
+#elif VOXEL_LAYOUT == VOXEL_LAYOUT_MORTON
+#define VOXEL_LAYOUT_NAME "morton"
+static_assert(REGION_SIZE_X == REGION_SIZE_Y && REGION_SIZE_Y == REGION_SIZE_Z && (REGION_SIZE_X & (REGION_SIZE_X - 1)) == 0, "Morton order needs cubic regions with a power of two size");
+#else
+#error "Unknown VOXEL_LAYOUT"
+#endif
+
+// Spreads the bits of a coordinate below 256 out to every third bit
+inline size_t spread_voxel_index_bits(u32 v) {
+    v = (v | (v << 8)) & 0xf00fu;
+    v = (v | (v << 4)) & 0xc30c3u;
+    v = (v | (v << 2)) & 0x249249u;
+    return v;
+}
+
+// The only place that knows the layout, everything that indexes voxel storage goes through here
+inline size_t get_voxel_index(u32 x, u32 y, u32 z) {
+    #if VOXEL_LAYOUT == VOXEL_LAYOUT_XYZ
+    return (((size_t) x * REGION_SIZE_Y) + y) * REGION_SIZE_Z + z;
+    #elif VOXEL_LAYOUT == VOXEL_LAYOUT_YXZ
+    return (((size_t) y * REGION_SIZE_X) + x) * REGION_SIZE_Z + z;
+    #else
+    return (spread_voxel_index_bits(x) << 2) | (spread_voxel_index_bits(y) << 1) | spread_voxel_index_bits(z);
+    #endif
+}
+
+inline bool is_voxel_type_array_uniform(const voxel_type_array_t* voxel_types) {
+    return voxel_types->bits_per_voxel == 0;
+}
+
+inline voxel_type_t get_voxel_type_from_array(const voxel_type_array_t* voxel_types, u32 x, u32 y, u32 z) {
+    if (is_voxel_type_array_uniform(voxel_types)) {
+        return voxel_types->palette[0];
+    }
+    size_t index = get_voxel_index(x, y, z);
+    if (voxel_types->bits_per_voxel == 8) {
+        return (voxel_type_t) voxel_types->data[index];
+    }
+    size_t bit_index = index * voxel_types->bits_per_voxel;
+    u8 palette_index = (u8) (voxel_types->data[bit_index / 8] >> (bit_index % 8)) & (u8) ((1u << voxel_types->bits_per_voxel) - 1u);
+    return voxel_types->palette[palette_index];
+}
+
+size_t get_voxel_type_array_num_bytes(const voxel_type_array_t* voxel_types);
+
+// Packs the given uncompressed types into voxel_types using the smallest number of bits per voxel that fits its palette
+void init_voxel_type_array(voxel_type_array_t* voxel_types, const voxel_type_t types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z]);
+void init_uniform_voxel_type_array(voxel_type_array_t* voxel_types, voxel_type_t type);
+// Deep copies src into dest, dest must be initialized
+void copy_voxel_type_array(voxel_type_array_t* dest, const voxel_type_array_t* src);
+// Leaves voxel_types as a uniform array of air
+void free_voxel_type_array(voxel_type_array_t* voxel_types);
+void copy_voxel_types_from_array(const voxel_type_array_t* voxel_types, voxel_type_t types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z]);
+
+// Promotes the array to more bits per voxel if the type is not in the palette yet and the palette is full.
+// Uniform arrays get their data allocated here on the first write of a different type.
+void set_voxel_type_in_array(voxel_type_array_t* voxel_types, u32 x, u32 y, u32 z, voxel_type_t type);
+
+inline u8 get_sky_light(voxel_light_t light) {
+    return light >> 4;
+}
+
+inline u8 get_block_light(voxel_light_t light) {
+    return light & MAX_LIGHT_LEVEL;
+}
+
+inline voxel_light_t get_voxel_light(u8 sky_light, u8 block_light) {
+    return (voxel_light_t) ((sky_light << 4) | block_light);
+}
+
+inline voxel_light_t get_voxel_light_from_array(const voxel_light_array_t* lights, u32 x, u32 y, u32 z) {
+    if (lights->data == NULL) {
+        return lights->uniform_light;
+    }
+    return lights->data[get_voxel_index(x, y, z)];
 }
 
-#define REGION_TYPE_3D(TYPE) typeof(TYPE (*)[world_size][world_size][world_size]) 
-#define REGION_CAST_3D(TYPE, VAR) (TYPE (*)[world_size][world_size][world_size]) (VAR)
+size_t get_voxel_light_array_num_bytes(const voxel_light_array_t* lights);
 
-s32vec3s get_region_position_from_voxel_world_position(s32vec3s voxel_world_pos);
\ No newline at end of file
+// Stores the given uncompressed lights into lights, as a uniform array if they are all the same
+void init_voxel_light_array(voxel_light_array_t* lights, const voxel_light_t uncompressed_lights[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z]);
+// Deep copies src into dest, dest must be initialized
+void copy_voxel_light_array(voxel_light_array_t* dest, const voxel_light_array_t* src);
+// Leaves lights as a uniform array of darkness
+void free_voxel_light_array(voxel_light_array_t* lights);
+// Uniform arrays get their data allocated here on the first write of a different light
+void set_voxel_light_in_array(voxel_light_array_t* lights, u32 x, u32 y, u32 z, voxel_light_t light);
\ No newline at end of file
@@ -0,0 +1,568 @@
+#include "region_lighting.h"
+#include "game/region.h"
+#include "game/region_management.h"
+#include "game/voxel.h"
+#include "game/voxel_type_info.h"
+#include "game_math.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Each spread voxel looks at up to 6 neighbors. Changes that reach further than this, like opening a cave up to the sky, show up over several frames instead of stalling one.
+#define MAX_LIGHT_NODES_PER_FRAME 2048
+#define MIN_LIGHT_QUEUE_NODES 256
+// Flood fills that would queue more than this, like opening up a huge cave to the sky, relight the regions they overflow in from scratch instead.
+// Far more than relighting a single region queues at its borders.
+#define MAX_LIGHT_QUEUE_NODES (4 * NUM_REGION_VOXELS)
+#define MAX_REGIONS_TO_RELIGHT 16
+
+typedef enum {
+    light_channel_sky,
+    light_channel_block
+} light_channel_t;
+
+#define NUM_LIGHT_CHANNELS 2
+
+typedef struct {
+    s32vec3s voxel_world_pos;
+    // Light level of the voxel when it was queued, for removals the level that was taken away
+    u8 light;
+} light_node_t;
+
+// First in first out so that light spreads breadth first, the nodes keep their memory between flood fills so they rarely grow
+typedef struct {
+    light_node_t* nodes;
+    size_t head;
+    size_t tail;
+    size_t num_allocated_nodes;
+} light_queue_t;
+
+// Indexed by light_channel_t. Removals are spread before additions, since they queue additions that fill the removed light back in from around it.
+static light_queue_t add_queues[NUM_LIGHT_CHANNELS];
+static light_queue_t removal_queues[NUM_LIGHT_CHANNELS];
+
+// Regions whose light nodes didn't fit into the light queues, relit by update_region_lighting once the queues are empty.
+// Regions that don't fit in here either keep their light as it is until their voxels change.
+static s32vec3s regions_to_relight[MAX_REGIONS_TO_RELIGHT];
+static size_t num_regions_to_relight;
+
+static void add_region_to_relight(s32vec3s region_pos) {
+    for (size_t i = 0; i < num_regions_to_relight; i++) {
+        if (regions_to_relight[i].x == region_pos.x && regions_to_relight[i].y == region_pos.y && regions_to_relight[i].z == region_pos.z) {
+            return;
+        }
+    }
+    if (num_regions_to_relight < MAX_REGIONS_TO_RELIGHT) {
+        regions_to_relight[num_regions_to_relight++] = region_pos;
+    }
+}
+
+static void push_light_node(light_queue_t* queue, s32vec3s voxel_world_pos, u8 light) {
+    if (queue->tail == queue->num_allocated_nodes) {
+        // Nodes that were already popped are moved out of the way instead of growing, unless that would only free up a few
+        if (queue->head > 0 && queue->head >= queue->num_allocated_nodes / 2) {
+            queue->tail -= queue->head;
+            memmove(queue->nodes, queue->nodes + queue->head, queue->tail * sizeof(*queue->nodes));
+            queue->head = 0;
+        } else {
+            size_t num_allocated_nodes = queue->num_allocated_nodes == 0 ? MIN_LIGHT_QUEUE_NODES : queue->num_allocated_nodes * 2;
+            if (num_allocated_nodes > MAX_LIGHT_QUEUE_NODES) {
+                num_allocated_nodes = MAX_LIGHT_QUEUE_NODES;
+            }
+            light_node_t* nodes = num_allocated_nodes == queue->num_allocated_nodes ? NULL : realloc(queue->nodes, num_allocated_nodes * sizeof(*queue->nodes));
+            if (nodes == NULL) {
+                add_region_to_relight(get_region_position_from_voxel_world_position(voxel_world_pos));
+                return;
+            }
+            queue->nodes = nodes;
+            queue->num_allocated_nodes = num_allocated_nodes;
+        }
+    }
+    queue->nodes[queue->tail++] = (light_node_t) {
+        .voxel_world_pos = voxel_world_pos,
+        .light = light
+    };
+}
+
+static bool pop_light_node(light_queue_t* queue, light_node_t* node) {
+    if (queue->head == queue->tail) {
+        return false;
+    }
+    *node = queue->nodes[queue->head++];
+    if (queue->head == queue->tail) {
+        queue->head = 0;
+        queue->tail = 0;
+    }
+    return true;
+}
+
+static u8 get_channel_light(voxel_light_t light, light_channel_t channel) {
+    return channel == light_channel_sky ? get_sky_light(light) : get_block_light(light);
+}
+
+static voxel_light_t set_channel_light(voxel_light_t light, light_channel_t channel, u8 level) {
+    return channel == light_channel_sky ? get_voxel_light(level, get_block_light(light)) : get_voxel_light(get_sky_light(light), level);
+}
+
+// Water dims sky light like any other step, only voxels that are see-through all the way keep it at full level
+static bool does_voxel_type_keep_sky_light(voxel_type_t type) {
+    voxel_mesh_category_t category = get_voxel_mesh_category(type);
+    return category == voxel_mesh_category_invisible || category == voxel_mesh_category_cross;
+}
+
+// Light level that a voxel lit with light gives to its non-opaque neighbor of the given type in the direction of face
+static u8 get_spread_light(light_channel_t channel, u8 light, voxel_face_t face, voxel_type_t neighbor_type) {
+    if (channel == light_channel_sky && face == voxel_face_bottom && light == MAX_LIGHT_LEVEL && does_voxel_type_keep_sky_light(neighbor_type)) {
+        return MAX_LIGHT_LEVEL;
+    }
+    return light == 0 ? 0 : (u8) (light - 1);
+}
+
+// Ordered by voxel_face_t
+static const s32vec3s face_offsets[6] = { {{ 1, 0, 0 }}, {{ -1, 0, 0 }}, {{ 0, 1, 0 }}, {{ 0, -1, 0 }}, {{ 0, 0, 1 }}, {{ 0, 0, -1 }} };
+
+static s32vec3s get_face_neighbor_voxel_world_position(voxel_face_t face, s32vec3s voxel_world_pos) {
+    return (s32vec3s) {{
+        voxel_world_pos.x + face_offsets[face].x,
+        voxel_world_pos.y + face_offsets[face].y,
+        voxel_world_pos.z + face_offsets[face].z
+    }};
+}
+
+// A loaded voxel, so that its type and light can be read and written without looking up its region again
+typedef struct {
+    const voxel_type_array_t* voxel_types;
+    voxel_light_array_t* lights;
+    u32vec3s local_pos;
+} lit_voxel_t;
+
+// Returns false if the voxel's region is not loaded
+static bool get_lit_voxel(s32vec3s voxel_world_pos, lit_voxel_t* voxel) {
+    s32vec3s region_pos = get_region_position_from_voxel_world_position(voxel_world_pos);
+    voxel->voxel_types = get_voxel_type_array_from_region_position(region_pos);
+    if (voxel->voxel_types == NULL) {
+        return false;
+    }
+    voxel->lights = get_voxel_light_array_from_region_position(region_pos);
+    voxel->local_pos = get_voxel_local_position_from_voxel_world_position(voxel_world_pos);
+    return true;
+}
+
+static voxel_type_t get_lit_voxel_type(const lit_voxel_t* voxel) {
+    return get_voxel_type_from_array(voxel->voxel_types, voxel->local_pos.x, voxel->local_pos.y, voxel->local_pos.z);
+}
+
+static voxel_light_t get_lit_voxel_light(const lit_voxel_t* voxel) {
+    return get_voxel_light_from_array(voxel->lights, voxel->local_pos.x, voxel->local_pos.y, voxel->local_pos.z);
+}
+
+// The regions showing the voxel are remeshed with its new light
+static void set_lit_voxel_light(const lit_voxel_t* voxel, s32vec3s voxel_world_pos, voxel_light_t light) {
+    set_voxel_light_in_array(voxel->lights, voxel->local_pos.x, voxel->local_pos.y, voxel->local_pos.z, light);
+    mark_region_lights_dirty_from_voxel_world_position(voxel_world_pos);
+}
+
+// Light that a voxel has no matter how its neighbors are lit, the light it gives off and the open sky above it if the region above isn't loaded
+static u8 get_voxel_own_light(light_channel_t channel, s32vec3s voxel_world_pos, voxel_type_t type) {
+    if (channel == light_channel_block) {
+        return voxel_type_infos[type].light_emission;
+    }
+    lit_voxel_t above;
+    if (is_voxel_type_opaque(type) || get_lit_voxel(get_face_neighbor_voxel_world_position(voxel_face_top, voxel_world_pos), &above)) {
+        return 0;
+    }
+    return get_spread_light(light_channel_sky, MAX_LIGHT_LEVEL, voxel_face_bottom, type);
+}
+
+// Darkens the neighbors that were lit by the removed light, and queues the neighbors lit from elsewhere to fill it back in
+static void spread_light_removal(light_channel_t channel, light_node_t node) {
+    for (u8 face = 0; face < 6; face++) {
+        s32vec3s neighbor_pos = get_face_neighbor_voxel_world_position((voxel_face_t) face, node.voxel_world_pos);
+        lit_voxel_t neighbor;
+        if (!get_lit_voxel(neighbor_pos, &neighbor)) {
+            continue;
+        }
+
+        voxel_light_t neighbor_light = get_lit_voxel_light(&neighbor);
+        u8 level = get_channel_light(neighbor_light, channel);
+        if (level == 0) {
+            continue;
+        }
+
+        // Full sky light straight below the removed light came down through it
+        bool lit_by_removed_light = level < node.light || (channel == light_channel_sky && face == voxel_face_bottom && node.light == MAX_LIGHT_LEVEL && level == MAX_LIGHT_LEVEL);
+        if (!lit_by_removed_light) {
+            push_light_node(&add_queues[channel], neighbor_pos, level);
+            continue;
+        }
+
+        // Voxels keep their own light and light their surroundings with it again once the removal has passed
+        u8 own_light = get_voxel_own_light(channel, neighbor_pos, get_lit_voxel_type(&neighbor));
+        set_lit_voxel_light(&neighbor, neighbor_pos, set_channel_light(neighbor_light, channel, own_light));
+        push_light_node(&removal_queues[channel], neighbor_pos, level);
+        if (own_light > 0) {
+            push_light_node(&add_queues[channel], neighbor_pos, own_light);
+        }
+    }
+}
+
+static void spread_light_addition(light_channel_t channel, light_node_t node) {
+    lit_voxel_t voxel;
+    if (!get_lit_voxel(node.voxel_world_pos, &voxel)) {
+        return;
+    }
+    // Read again since the light may have been changed by another node after this one was queued
+    u8 level = get_channel_light(get_lit_voxel_light(&voxel), channel);
+    if (level <= 1) {
+        return;
+    }
+
+    for (u8 face = 0; face < 6; face++) {
+        s32vec3s neighbor_pos = get_face_neighbor_voxel_world_position((voxel_face_t) face, node.voxel_world_pos);
+        lit_voxel_t neighbor;
+        if (!get_lit_voxel(neighbor_pos, &neighbor)) {
+            continue;
+        }
+
+        voxel_type_t neighbor_type = get_lit_voxel_type(&neighbor);
+        if (is_voxel_type_opaque(neighbor_type)) {
+            continue;
+        }
+
+        voxel_light_t neighbor_light = get_lit_voxel_light(&neighbor);
+        u8 spread_level = get_spread_light(channel, level, (voxel_face_t) face, neighbor_type);
+        if (spread_level <= get_channel_light(neighbor_light, channel)) {
+            continue;
+        }
+        set_lit_voxel_light(&neighbor, neighbor_pos, set_channel_light(neighbor_light, channel, spread_level));
+        push_light_node(&add_queues[channel], neighbor_pos, spread_level);
+    }
+}
+
+// Returns false if every queue is empty
+static bool spread_next_light_node(void) {
+    light_node_t node;
+    for (u8 channel = 0; channel < NUM_LIGHT_CHANNELS; channel++) {
+        if (pop_light_node(&removal_queues[channel], &node)) {
+            spread_light_removal((light_channel_t) channel, node);
+            return true;
+        }
+    }
+    for (u8 channel = 0; channel < NUM_LIGHT_CHANNELS; channel++) {
+        if (pop_light_node(&add_queues[channel], &node)) {
+            spread_light_addition((light_channel_t) channel, node);
+            return true;
+        }
+    }
+    return false;
+}
+
+void update_light_at_voxel_world_position(s32vec3s voxel_world_pos) {
+    lit_voxel_t voxel;
+    if (!get_lit_voxel(voxel_world_pos, &voxel)) {
+        return;
+    }
+    voxel_type_t type = get_lit_voxel_type(&voxel);
+
+    for (u8 channel_index = 0; channel_index < NUM_LIGHT_CHANNELS; channel_index++) {
+        light_channel_t channel = (light_channel_t) channel_index;
+        voxel_light_t light = get_lit_voxel_light(&voxel);
+        u8 level = get_channel_light(light, channel);
+        u8 own_light = get_voxel_own_light(channel, voxel_world_pos, type);
+
+        // The old light is taken away before the voxel's own and its neighbors' light is spread into it again
+        if (level > 0) {
+            push_light_node(&removal_queues[channel], voxel_world_pos, level);
+        }
+        if (level != own_light) {
+            set_lit_voxel_light(&voxel, voxel_world_pos, set_channel_light(light, channel, own_light));
+        }
+        if (own_light > 0) {
+            push_light_node(&add_queues[channel], voxel_world_pos, own_light);
+        }
+
+        if (is_voxel_type_opaque(type)) {
+            continue;
+        }
+        for (u8 face = 0; face < 6; face++) {
+            s32vec3s neighbor_pos = get_face_neighbor_voxel_world_position((voxel_face_t) face, voxel_world_pos);
+            lit_voxel_t neighbor;
+            if (!get_lit_voxel(neighbor_pos, &neighbor)) {
+                continue;
+            }
+            u8 neighbor_level = get_channel_light(get_lit_voxel_light(&neighbor), channel);
+            if (neighbor_level > 1) {
+                push_light_node(&add_queues[channel], neighbor_pos, neighbor_level);
+            }
+        }
+    }
+}
+
+static bool is_local_position_in_region(s32 x, s32 y, s32 z) {
+    return (u32) x < REGION_SIZE_X && (u32) y < REGION_SIZE_Y && (u32) z < REGION_SIZE_Z;
+}
+
+// Index into the flat buffers of region_light_buffers_t
+static u32 get_buffer_index(u32 x, u32 y, u32 z) {
+    return (x * REGION_SIZE_Y + y) * REGION_SIZE_Z + z;
+}
+
+// Returns true if the voxel's light in channel would raise the light of any of its neighbors inside the region
+static bool can_buffered_light_spread(const region_light_buffers_t* buffers, light_channel_t channel, u32 x, u32 y, u32 z) {
+    u8 level = get_channel_light(buffers->lights[x][y][z], channel);
+    if (level <= 1) {
+        return false;
+    }
+    for (u8 face = 0; face < 6; face++) {
+        s32 nx = (s32) x + face_offsets[face].x;
+        s32 ny = (s32) y + face_offsets[face].y;
+        s32 nz = (s32) z + face_offsets[face].z;
+        if (!is_local_position_in_region(nx, ny, nz)) {
+            continue;
+        }
+        voxel_type_t neighbor_type = buffers->voxel_types[nx][ny][nz];
+        if (!is_voxel_type_opaque(neighbor_type) && get_spread_light(channel, level, (voxel_face_t) face, neighbor_type) > get_channel_light(buffers->lights[nx][ny][nz], channel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void push_buffered_voxel(region_light_buffers_t* buffers, u32 index) {
+    if (buffers->queued[index]) {
+        return;
+    }
+    buffers->queued[index] = true;
+    buffers->queue[buffers->tail++ % NUM_REGION_VOXELS] = index;
+}
+
+// Same flood fill as spread_light_addition, only inside of the buffered region
+static void spread_buffered_light(region_light_buffers_t* buffers, light_channel_t channel) {
+    voxel_light_t* flat_lights = &buffers->lights[0][0][0];
+    const voxel_type_t* flat_voxel_types = &buffers->voxel_types[0][0][0];
+
+    buffers->head = 0;
+    buffers->tail = 0;
+    memset(buffers->queued, false, sizeof(buffers->queued));
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                if (can_buffered_light_spread(buffers, channel, x, y, z)) {
+                    push_buffered_voxel(buffers, get_buffer_index(x, y, z));
+                }
+            }
+        }
+    }
+
+    while (buffers->head != buffers->tail) {
+        u32 index = buffers->queue[buffers->head++ % NUM_REGION_VOXELS];
+        buffers->queued[index] = false;
+        u8 level = get_channel_light(flat_lights[index], channel);
+        s32 x = (s32) (index / (REGION_SIZE_Y * REGION_SIZE_Z));
+        s32 y = (s32) (index / REGION_SIZE_Z % REGION_SIZE_Y);
+        s32 z = (s32) (index % REGION_SIZE_Z);
+
+        for (u8 face = 0; face < 6; face++) {
+            s32 nx = x + face_offsets[face].x;
+            s32 ny = y + face_offsets[face].y;
+            s32 nz = z + face_offsets[face].z;
+            if (!is_local_position_in_region(nx, ny, nz)) {
+                continue;
+            }
+            u32 neighbor_index = get_buffer_index((u32) nx, (u32) ny, (u32) nz);
+            voxel_type_t neighbor_type = flat_voxel_types[neighbor_index];
+            if (is_voxel_type_opaque(neighbor_type)) {
+                continue;
+            }
+            u8 spread_level = get_spread_light(channel, level, (voxel_face_t) face, neighbor_type);
+            if (spread_level <= get_channel_light(flat_lights[neighbor_index], channel)) {
+                continue;
+            }
+            flat_lights[neighbor_index] = set_channel_light(flat_lights[neighbor_index], channel, spread_level);
+            if (spread_level > 1) {
+                push_buffered_voxel(buffers, neighbor_index);
+            }
+        }
+    }
+}
+
+// Sky light is brought straight down each column first, since that is all of it in the open, and only spread sideways where it has to
+void light_region_voxels(region_light_buffers_t* buffers, const voxel_type_array_t* voxel_types, const u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z], voxel_light_array_t* lights) {
+    copy_voxel_types_from_array(voxel_types, buffers->voxel_types);
+
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+            u8 sky_light = above_sky_lights[x][z];
+            for (u32 y = REGION_SIZE_Y; y-- > 0;) {
+                voxel_type_t type = buffers->voxel_types[x][y][z];
+                sky_light = is_voxel_type_opaque(type) ? 0 : get_spread_light(light_channel_sky, sky_light, voxel_face_bottom, type);
+                buffers->lights[x][y][z] = get_voxel_light(sky_light, voxel_type_infos[type].light_emission);
+            }
+        }
+    }
+
+    for (u8 channel = 0; channel < NUM_LIGHT_CHANNELS; channel++) {
+        spread_buffered_light(buffers, (light_channel_t) channel);
+    }
+
+    init_voxel_light_array(lights, buffers->lights);
+}
+
+void get_region_above_sky_lights(s32vec3s region_pos, u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z]) {
+    const voxel_light_array_t* above_lights = get_voxel_light_array_from_region_position((s32vec3s) {{ region_pos.x, region_pos.y + 1, region_pos.z }});
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+            above_sky_lights[x][z] = above_lights == NULL ? MAX_LIGHT_LEVEL : get_sky_light(get_voxel_light_from_array(above_lights, x, 0, z));
+        }
+    }
+}
+
+// Queues the light that crosses between a voxel on the border of a newly lit region and its neighbor in the direction of face, if that is loaded
+static void queue_region_border_light(s32vec3s voxel_world_pos, voxel_type_t type, voxel_light_t light, voxel_face_t face) {
+    s32vec3s neighbor_pos = get_face_neighbor_voxel_world_position(face, voxel_world_pos);
+    lit_voxel_t neighbor;
+    if (!get_lit_voxel(neighbor_pos, &neighbor)) {
+        return;
+    }
+    voxel_type_t neighbor_type = get_lit_voxel_type(&neighbor);
+    voxel_light_t neighbor_light = get_lit_voxel_light(&neighbor);
+
+    for (u8 channel_index = 0; channel_index < NUM_LIGHT_CHANNELS; channel_index++) {
+        light_channel_t channel = (light_channel_t) channel_index;
+        u8 level = get_channel_light(light, channel);
+        u8 neighbor_level = get_channel_light(neighbor_light, channel);
+        if (!is_voxel_type_opaque(neighbor_type) && get_spread_light(channel, level, face, neighbor_type) > neighbor_level) {
+            push_light_node(&add_queues[channel], voxel_world_pos, level);
+        }
+        // Opposite faces only differ in the lowest bit
+        if (!is_voxel_type_opaque(type) && get_spread_light(channel, neighbor_level, (voxel_face_t) (face ^ 1), type) > level) {
+            push_light_node(&add_queues[channel], neighbor_pos, neighbor_level);
+        }
+    }
+
+    // The region below was lit as if this one was open sky, so the sky light that came down into it is taken back where this region lets less through
+    if (face != voxel_face_bottom) {
+        return;
+    }
+    u8 open_sky_light = get_spread_light(light_channel_sky, MAX_LIGHT_LEVEL, face, neighbor_type);
+    if (get_sky_light(neighbor_light) == open_sky_light && get_spread_light(light_channel_sky, get_sky_light(light), face, neighbor_type) < open_sky_light) {
+        set_lit_voxel_light(&neighbor, neighbor_pos, set_channel_light(neighbor_light, light_channel_sky, 0));
+        push_light_node(&removal_queues[light_channel_sky], neighbor_pos, open_sky_light);
+    }
+}
+
+// The region may have been lit with sky light coming down from above that has changed since, or from a region above that has been loaded or unloaded since
+static void correct_region_top_sky_light(s32vec3s region_pos, const u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z]) {
+    u8 current_above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z];
+    get_region_above_sky_lights(region_pos, current_above_sky_lights);
+
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+            s32vec3s voxel_world_pos = {{ region_pos.x * REGION_SIZE_X + (s32) x, region_pos.y * REGION_SIZE_Y + REGION_SIZE_Y - 1, region_pos.z * REGION_SIZE_Z + (s32) z }};
+            lit_voxel_t voxel;
+            get_lit_voxel(voxel_world_pos, &voxel);
+            voxel_type_t type = get_lit_voxel_type(&voxel);
+            if (is_voxel_type_opaque(type)) {
+                continue;
+            }
+            voxel_light_t light = get_lit_voxel_light(&voxel);
+            u8 lit_sky_light = get_spread_light(light_channel_sky, above_sky_lights[x][z], voxel_face_bottom, type);
+            u8 current_sky_light = get_spread_light(light_channel_sky, current_above_sky_lights[x][z], voxel_face_bottom, type);
+
+            if (current_sky_light < lit_sky_light && get_sky_light(light) == lit_sky_light) {
+                set_lit_voxel_light(&voxel, voxel_world_pos, set_channel_light(light, light_channel_sky, 0));
+                push_light_node(&removal_queues[light_channel_sky], voxel_world_pos, lit_sky_light);
+            } else if (current_sky_light > get_sky_light(light)) {
+                // Sky light from a loaded region above is queued with the rest of the border, only open sky has to be let in here
+                u8 own_light = get_voxel_own_light(light_channel_sky, voxel_world_pos, type);
+                if (own_light > get_sky_light(light)) {
+                    set_lit_voxel_light(&voxel, voxel_world_pos, set_channel_light(light, light_channel_sky, own_light));
+                    push_light_node(&add_queues[light_channel_sky], voxel_world_pos, own_light);
+                }
+            }
+        }
+    }
+}
+
+void light_region_borders(s32vec3s region_pos, const u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z]) {
+    correct_region_top_sky_light(region_pos, above_sky_lights);
+
+    const voxel_type_array_t* voxel_types = get_voxel_type_array_from_region_position(region_pos);
+    const voxel_light_array_t* lights = get_voxel_light_array_from_region_position(region_pos);
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                bool on_border = x == 0 || y == 0 || z == 0 || x == REGION_SIZE_X - 1 || y == REGION_SIZE_Y - 1 || z == REGION_SIZE_Z - 1;
+                if (!on_border) {
+                    continue;
+                }
+
+                s32vec3s voxel_world_pos = {{ region_pos.x * REGION_SIZE_X + (s32) x, region_pos.y * REGION_SIZE_Y + (s32) y, region_pos.z * REGION_SIZE_Z + (s32) z }};
+                voxel_type_t type = get_voxel_type_from_array(voxel_types, x, y, z);
+                voxel_light_t light = get_voxel_light_from_array(lights, x, y, z);
+                for (u8 face = 0; face < 6; face++) {
+                    if (!is_local_position_in_region((s32) x + face_offsets[face].x, (s32) y + face_offsets[face].y, (s32) z + face_offsets[face].z)) {
+                        queue_region_border_light(voxel_world_pos, type, light, (voxel_face_t) face);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Only used on the main thread
+static region_light_buffers_t relight_buffers;
+
+// Lights a loaded region again from scratch, along with the light crossing its borders
+static void light_region(s32vec3s region_pos) {
+    voxel_light_array_t* lights = get_voxel_light_array_from_region_position(region_pos);
+    if (lights == NULL) {
+        return;
+    }
+
+    u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z];
+    get_region_above_sky_lights(region_pos, above_sky_lights);
+    light_region_voxels(&relight_buffers, get_voxel_type_array_from_region_position(region_pos), above_sky_lights, lights);
+    light_region_borders(region_pos, above_sky_lights);
+
+    // Every neighbor of the region is next to one of its corners
+    for (s32 x = 0; x < 2; x++) {
+        for (s32 y = 0; y < 2; y++) {
+            for (s32 z = 0; z < 2; z++) {
+                mark_region_lights_dirty_from_voxel_world_position((s32vec3s) {{
+                    region_pos.x * REGION_SIZE_X + x * (REGION_SIZE_X - 1),
+                    region_pos.y * REGION_SIZE_Y + y * (REGION_SIZE_Y - 1),
+                    region_pos.z * REGION_SIZE_Z + z * (REGION_SIZE_Z - 1)
+                }});
+            }
+        }
+    }
+}
+
+static bool are_light_queues_empty(void) {
+    for (u8 channel = 0; channel < NUM_LIGHT_CHANNELS; channel++) {
+        if (removal_queues[channel].head != removal_queues[channel].tail || add_queues[channel].head != add_queues[channel].tail) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_light_spreading(void) {
+    return !are_light_queues_empty() || num_regions_to_relight > 0;
+}
+
+void update_region_lighting(void) {
+    // Regions are relit one at a time into empty queues, so that relighting can't overflow them by itself
+    if (num_regions_to_relight > 0 && are_light_queues_empty()) {
+        s32vec3s region_pos = regions_to_relight[0];
+        num_regions_to_relight--;
+        memmove(regions_to_relight, regions_to_relight + 1, num_regions_to_relight * sizeof(*regions_to_relight));
+        light_region(region_pos);
+    }
+
+    for (u32 i = 0; i < MAX_LIGHT_NODES_PER_FRAME; i++) {
+        if (!spread_next_light_node()) {
+            return;
+        }
+    }
+}
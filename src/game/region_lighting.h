@@ -0,0 +1,34 @@
+#pragma once
+#include "game/region.h"
+#include "game_math.h"
+
+// Sky light enters the loaded regions from above at MAX_LIGHT_LEVEL and keeps that level straight down through air and crosses.
+// Block light starts at the light emission of its voxel's type. Otherwise both lose a level per voxel they spread to and don't spread into opaque voxels.
+// Changes are flood filled outwards from where they happen, across region borders, so only voxels whose light actually changes are visited.
+// The flood fills are queued and spread over frames by update_region_lighting, every region whose light changes is remeshed once they are done.
+
+// Scratch space for light_region_voxels, every thread that lights regions needs its own
+typedef struct {
+    voxel_type_t voxel_types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z];
+    voxel_light_t lights[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z];
+    // Flood fill of the voxels whose light still has to spread, a voxel is only queued once at a time so it never holds more than every voxel
+    u32 queue[NUM_REGION_VOXELS];
+    bool queued[NUM_REGION_VOXELS];
+    size_t head;
+    size_t tail;
+} region_light_buffers_t;
+
+// Lights a region as far as light spreads inside of it, from the sky light that comes down from the bottom layer of the region above and the light its voxels give off.
+// Doesn't look at any loaded region, so it is safe to call from any thread with its own buffers.
+void light_region_voxels(region_light_buffers_t* buffers, const voxel_type_array_t* voxel_types, const u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z], voxel_light_array_t* lights);
+// Sky light of the bottom layer of the region above, MAX_LIGHT_LEVEL everywhere if that region isn't loaded
+void get_region_above_sky_lights(s32vec3s region_pos, u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z]);
+// Queues the light that crosses between a region newly lit by light_region_voxels from above_sky_lights and its loaded neighbors.
+// The region above may have changed since above_sky_lights were taken, the region's top layer is corrected for that.
+void light_region_borders(s32vec3s region_pos, const u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z]);
+// Queues the light changes caused by the voxel at the given voxel world position changing its type, should be called after the type has changed
+void update_light_at_voxel_world_position(s32vec3s voxel_world_pos);
+// Spreads the queued light changes, at most MAX_LIGHT_NODES_PER_FRAME voxels each call. Should be called once per frame before update_dirty_region_visuals.
+void update_region_lighting(void);
+// Returns true while update_region_lighting still has light changes queued
+bool is_light_spreading(void);
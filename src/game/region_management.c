@@ -1,17 +1,56 @@
 #include "region_management.h"
+#include "game/display_list_pool.h"
 #include "game/region.h"
-#include "game/region_procedural_generation.h"
+#include "game/region_lighting.h"
+#include "game/region_mesh_cache.h"
 #include "game/region_visual_generation.h"
+#include "game/region_worker.h"
 #include "game/voxel.h"
+#include "chrono.h"
 #include "game_math.h"
 #include "log.h"
+#include "util.h"
 #include <cglm/ivec3.h>
+#include <stdlib.h>
 #include <string.h>
 
-alignas(32) u32 world_size;
+alignas(32) u32vec3s world_size;
 s32vec3s corner_region_pos;
-alignas(32) voxel_type_array_t** region_voxel_type_arrays;
+alignas(32) voxel_type_array_t* region_voxel_type_arrays;
+alignas(32) voxel_light_array_t* region_voxel_light_arrays;
 alignas(32) region_render_info_t* region_render_infos;
+u32 num_streamed_regions;
+
+// Regions are stored toroidally: a region lives in the slot given by its position modulo world_size, so moving the loaded window only recycles the slots of the regions that left it
+typedef struct {
+    // Incremented whenever the slot gets a new region, so generate jobs for the region that was there before are dropped
+    u32 generation_epoch;
+    // Incremented whenever the slot's region is meshed again, so only the latest mesh job is published
+    u32 mesh_epoch;
+    // Whether the slot's voxels have been generated
+    bool loaded;
+} region_slot_t;
+
+static region_slot_t* region_slots;
+static size_t num_unloaded_regions;
+
+// Slots in the order they were added, a slot that is added again before it is processed keeps its place
+typedef struct {
+    bool* contained;
+    u32vec3s* slot_positions;
+    size_t num_slot_positions;
+} region_slot_list_t;
+
+// Regions whose meshes are out of date because of voxel edits, remeshed on the main thread so the edit shows up on the next frame
+static region_slot_list_t dirty_regions;
+// Regions whose meshes are out of date because light spread through them, remeshed on the region worker once the light has finished spreading
+static region_slot_list_t light_dirty_regions;
+// Regions waiting for a generate or mesh job to be pushed to the region worker
+static region_slot_list_t regions_to_generate;
+static region_slot_list_t regions_to_mesh;
+
+// Only used for meshing on the main thread, the region worker has its own
+static region_mesh_buffers_t mesh_buffers;
 
 u32vec3s get_region_relative_position(s32vec3s region_pos) {
     return (u32vec3s) {{
@@ -21,91 +60,564 @@ u32vec3s get_region_relative_position(s32vec3s region_pos) {
     }};
 }
 
-static s32vec3s get_region_position(u32vec3s region_rel_pos) {
+bool is_region_relative_position_out_of_bounds(u32vec3s region_rel_pos) {
+    return region_rel_pos.x >= world_size.x || region_rel_pos.y >= world_size.y || region_rel_pos.z >= world_size.z;
+}
+
+u32vec3s get_region_slot_position(s32vec3s region_pos) {
+    return (u32vec3s) {{
+        (u32) mod_s32(region_pos.x, (s32) world_size.x),
+        (u32) mod_s32(region_pos.y, (s32) world_size.y),
+        (u32) mod_s32(region_pos.z, (s32) world_size.z)
+    }};
+}
+
+s32vec3s get_region_position_from_slot_position(u32vec3s region_slot_pos) {
     return (s32vec3s) {{
-        (s32) region_rel_pos.x + corner_region_pos.x,
-        (s32) region_rel_pos.y + corner_region_pos.y,
-        (s32) region_rel_pos.z + corner_region_pos.z
+        corner_region_pos.x + mod_s32((s32) region_slot_pos.x - corner_region_pos.x, (s32) world_size.x),
+        corner_region_pos.y + mod_s32((s32) region_slot_pos.y - corner_region_pos.y, (s32) world_size.y),
+        corner_region_pos.z + mod_s32((s32) region_slot_pos.z - corner_region_pos.z, (s32) world_size.z)
     }};
 }
 
-bool is_region_relative_position_out_of_bounds(u32vec3s region_rel_pos) {
-    return region_rel_pos.x >= world_size || region_rel_pos.y >= world_size || region_rel_pos.z >= world_size;
+size_t get_region_slot_index(u32vec3s region_slot_pos) {
+    return (region_slot_pos.x * world_size.y + region_slot_pos.y) * world_size.z + region_slot_pos.z;
 }
 
-voxel_type_t* get_voxel_type_from_voxel_world_position(s32vec3s voxel_world_pos) {
-    REGION_TYPE_3D(voxel_type_array_t*) voxel_type_arrays = REGION_CAST_3D(voxel_type_array_t*, region_voxel_type_arrays);
+static void init_region_slot_list(region_slot_list_t* list) {
+    list->contained = malloc(get_num_regions() * sizeof(*list->contained));
+    list->slot_positions = malloc(get_num_regions() * sizeof(*list->slot_positions));
+    memset(list->contained, 0, get_num_regions() * sizeof(*list->contained));
+    list->num_slot_positions = 0;
+}
 
-    s32vec3s region_pos = get_region_position_from_voxel_world_position(voxel_world_pos);
-    u32vec3s region_rel_pos = get_region_relative_position(region_pos);
-    if (is_region_relative_position_out_of_bounds(region_rel_pos)) {
+static void add_to_region_slot_list(region_slot_list_t* list, u32vec3s region_slot_pos) {
+    size_t index = get_region_slot_index(region_slot_pos);
+    if (list->contained[index]) {
+        return;
+    }
+    list->contained[index] = true;
+    list->slot_positions[list->num_slot_positions++] = region_slot_pos;
+}
+
+static void remove_front_of_region_slot_list(region_slot_list_t* list, size_t num_slot_positions) {
+    for (size_t i = 0; i < num_slot_positions; i++) {
+        list->contained[get_region_slot_index(list->slot_positions[i])] = false;
+    }
+    list->num_slot_positions -= num_slot_positions;
+    memmove(list->slot_positions, list->slot_positions + num_slot_positions, list->num_slot_positions * sizeof(*list->slot_positions));
+}
+
+static bool is_region_loaded(s32vec3s region_pos) {
+    if (is_region_relative_position_out_of_bounds(get_region_relative_position(region_pos))) {
+        return false;
+    }
+    return region_slots[get_region_slot_index(get_region_slot_position(region_pos))].loaded;
+}
+
+static voxel_type_array_t* get_mutable_voxel_type_array_from_region_position(s32vec3s region_pos) {
+    REGION_TYPE_3D(voxel_type_array_t) voxel_type_arrays = REGION_CAST_3D(voxel_type_array_t, region_voxel_type_arrays);
+
+    if (!is_region_loaded(region_pos)) {
         return NULL;
     }
 
-    voxel_type_array_t* voxel_types = (*voxel_type_arrays)[region_rel_pos.x][region_rel_pos.y][region_rel_pos.z];
-    if (voxel_types == NULL) {
+    u32vec3s region_slot_pos = get_region_slot_position(region_pos);
+    return &(*voxel_type_arrays)[region_slot_pos.x][region_slot_pos.y][region_slot_pos.z];
+}
+
+const voxel_type_array_t* get_voxel_type_array_from_region_position(s32vec3s region_pos) {
+    return get_mutable_voxel_type_array_from_region_position(region_pos);
+}
+
+voxel_light_array_t* get_voxel_light_array_from_region_position(s32vec3s region_pos) {
+    if (!is_region_loaded(region_pos)) {
         return NULL;
     }
+    return &region_voxel_light_arrays[get_region_slot_index(get_region_slot_position(region_pos))];
+}
+
+static voxel_type_array_t* get_voxel_type_array_from_voxel_world_position(s32vec3s voxel_world_pos) {
+    return get_mutable_voxel_type_array_from_region_position(get_region_position_from_voxel_world_position(voxel_world_pos));
+}
+
+voxel_type_wrap_t get_voxel_type_from_voxel_world_position(s32vec3s voxel_world_pos) {
+    const voxel_type_array_t* voxel_types = get_voxel_type_array_from_voxel_world_position(voxel_world_pos);
+    if (voxel_types == NULL) {
+        return (voxel_type_wrap_t) { .success = false };
+    }
 
     u32vec3s voxel_local_pos = get_voxel_local_position_from_voxel_world_position(voxel_world_pos);
-    return &voxel_types->types[voxel_local_pos.x][voxel_local_pos.y][voxel_local_pos.z];
+    return (voxel_type_wrap_t) {
+        .success = true,
+        .val = get_voxel_type_from_array(voxel_types, voxel_local_pos.x, voxel_local_pos.y, voxel_local_pos.z)
+    };
 }
 
-static const voxel_type_array_t* get_neighbor_voxel_type_array(u32vec3s region_rel_pos) {
-	REGION_TYPE_3D(const voxel_type_array_t*) voxel_type_arrays = REGION_CAST_3D(const voxel_type_array_t*, region_voxel_type_arrays);
-    if (is_region_relative_position_out_of_bounds(region_rel_pos)) {
-        return NULL;
+static void mark_region_dirty(region_slot_list_t* list, s32vec3s region_pos) {
+    if (!is_region_loaded(region_pos)) {
+        return;
+    }
+    add_to_region_slot_list(list, get_region_slot_position(region_pos));
+}
+
+// Neighboring regions cull their border faces against this region and are lit by its border voxels, so they also have to be remeshed when a border voxel changes.
+// Voxels along the region's edges and corners are also in the aprons of the diagonal neighbors, whose ambient occlusion depends on them.
+static void mark_regions_dirty_around_voxel(region_slot_list_t* list, s32vec3s voxel_world_pos) {
+    s32vec3s region_pos = get_region_position_from_voxel_world_position(voxel_world_pos);
+    u32vec3s voxel_local_pos = get_voxel_local_position_from_voxel_world_position(voxel_world_pos);
+
+    u32vec3s region_size = {{ REGION_SIZE_X, REGION_SIZE_Y, REGION_SIZE_Z }};
+    s32vec3s min_offset;
+    s32vec3s max_offset;
+    for (u32 i = 0; i < 3; i++) {
+        min_offset.raw[i] = voxel_local_pos.raw[i] == 0 ? -1 : 0;
+        max_offset.raw[i] = voxel_local_pos.raw[i] == region_size.raw[i] - 1 ? 1 : 0;
+    }
+
+    for (s32 x = min_offset.x; x <= max_offset.x; x++) {
+        for (s32 y = min_offset.y; y <= max_offset.y; y++) {
+            for (s32 z = min_offset.z; z <= max_offset.z; z++) {
+                mark_region_dirty(list, (s32vec3s) {{ region_pos.x + x, region_pos.y + y, region_pos.z + z }});
+            }
+        }
+    }
+}
+
+void mark_regions_dirty_from_voxel_world_position(s32vec3s voxel_world_pos) {
+    mark_regions_dirty_around_voxel(&dirty_regions, voxel_world_pos);
+}
+
+void mark_region_lights_dirty_from_voxel_world_position(s32vec3s voxel_world_pos) {
+    mark_regions_dirty_around_voxel(&light_dirty_regions, voxel_world_pos);
+}
+
+bool set_voxel_type_at_voxel_world_position(s32vec3s voxel_world_pos, voxel_type_t type) {
+    voxel_type_array_t* voxel_types = get_voxel_type_array_from_voxel_world_position(voxel_world_pos);
+    if (voxel_types == NULL) {
+        return false;
+    }
+
+    u32vec3s voxel_local_pos = get_voxel_local_position_from_voxel_world_position(voxel_world_pos);
+    if (get_voxel_type_from_array(voxel_types, voxel_local_pos.x, voxel_local_pos.y, voxel_local_pos.z) == type) {
+        return true;
+    }
+
+    set_voxel_type_in_array(voxel_types, voxel_local_pos.x, voxel_local_pos.y, voxel_local_pos.z, type);
+    mark_regions_dirty_from_voxel_world_position(voxel_world_pos);
+    update_light_at_voxel_world_position(voxel_world_pos);
+    return true;
+}
+
+static void copy_apron_edges_of_region(s32vec3s region_pos, region_apron_edges_t* apron_edges) {
+    const voxel_type_array_t* edge_neighbor_voxel_types[NUM_REGION_EDGE_NEIGHBORS];
+    for (size_t i = 0; i < NUM_REGION_EDGE_NEIGHBORS; i++) {
+        edge_neighbor_voxel_types[i] = get_voxel_type_array_from_region_position((s32vec3s) {{
+            region_pos.x + region_edge_neighbor_offsets[i].x,
+            region_pos.y + region_edge_neighbor_offsets[i].y,
+            region_pos.z + region_edge_neighbor_offsets[i].z
+        }});
+    }
+    copy_region_apron_edges(apron_edges, edge_neighbor_voxel_types);
+}
+
+static void generate_visuals_for_region(u32vec3s region_slot_pos) {
+	REGION_TYPE_3D(const voxel_type_array_t) voxel_type_arrays = REGION_CAST_3D(const voxel_type_array_t, region_voxel_type_arrays);
+	REGION_TYPE_3D(region_render_info_t) render_infos = REGION_CAST_3D(region_render_info_t, region_render_infos);
+
+    s32vec3s region_pos = get_region_position_from_slot_position(region_slot_pos);
+    s32 x = region_pos.x;
+    s32 y = region_pos.y;
+    s32 z = region_pos.z;
+
+    const voxel_type_array_t* voxel_types = &(*voxel_type_arrays)[region_slot_pos.x][region_slot_pos.y][region_slot_pos.z];
+    const voxel_light_array_t* lights = &region_voxel_light_arrays[get_region_slot_index(region_slot_pos)];
+    region_render_info_t* render_info = &(*render_infos)[region_slot_pos.x][region_slot_pos.y][region_slot_pos.z];
+
+    // Drops any mesh job for this region that is still in flight, since it was made from older voxels
+    region_slots[get_region_slot_index(region_slot_pos)].mesh_epoch++;
+
+    s64 start = get_current_us();
+
+    // Ordered by voxel_face_t
+    const voxel_type_array_t* neighbor_voxel_types[6] = {
+        get_voxel_type_array_from_region_position((s32vec3s) {{ x + 1, y, z }}),
+        get_voxel_type_array_from_region_position((s32vec3s) {{ x - 1, y, z }}),
+        get_voxel_type_array_from_region_position((s32vec3s) {{ x, y + 1, z }}),
+        get_voxel_type_array_from_region_position((s32vec3s) {{ x, y - 1, z }}),
+        get_voxel_type_array_from_region_position((s32vec3s) {{ x, y, z + 1 }}),
+        get_voxel_type_array_from_region_position((s32vec3s) {{ x, y, z - 1 }})
+    };
+    const voxel_light_array_t* neighbor_lights[6] = {
+        get_voxel_light_array_from_region_position((s32vec3s) {{ x + 1, y, z }}),
+        get_voxel_light_array_from_region_position((s32vec3s) {{ x - 1, y, z }}),
+        get_voxel_light_array_from_region_position((s32vec3s) {{ x, y + 1, z }}),
+        get_voxel_light_array_from_region_position((s32vec3s) {{ x, y - 1, z }}),
+        get_voxel_light_array_from_region_position((s32vec3s) {{ x, y, z + 1 }}),
+        get_voxel_light_array_from_region_position((s32vec3s) {{ x, y, z - 1 }})
+    };
+
+    static region_apron_edges_t apron_edges;
+    copy_apron_edges_of_region(region_pos, &apron_edges);
+
+    generate_region_visuals(&mesh_buffers, voxel_types, neighbor_voxel_types, &apron_edges, lights, neighbor_lights, render_info);
+
+    last_visual_gen_time = (us_t) (get_current_us() - start);
+    total_visual_gen_time += last_visual_gen_time;
+}
+
+static void generate_visuals_for_all_regions(void) {
+	for (u32 x = 0; x < world_size.x; x++) {
+		for (u32 y = 0; y < world_size.y; y++) {
+			for (u32 z = 0; z < world_size.z; z++) {
+                u32vec3s region_slot_pos = {{ x, y, z }};
+                if (!region_slots[get_region_slot_index(region_slot_pos)].loaded) {
+                    continue;
+                }
+                generate_visuals_for_region(region_slot_pos);
+            }
+        }
+    }
+}
+
+// A region is only meshed once all of its loaded neighbors have been generated, so that it isn't meshed again for every neighbor that arrives.
+// That includes the diagonal neighbors, which the apron's edges and corners come from.
+static bool is_region_ready_to_mesh(s32vec3s region_pos) {
+    if (!is_region_loaded(region_pos)) {
+        return false;
+    }
+    for (s32 x = -1; x <= 1; x++) {
+        for (s32 y = -1; y <= 1; y++) {
+            for (s32 z = -1; z <= 1; z++) {
+                s32vec3s neighbor_pos = {{ region_pos.x + x, region_pos.y + y, region_pos.z + z }};
+                if (!is_region_relative_position_out_of_bounds(get_region_relative_position(neighbor_pos)) && !is_region_loaded(neighbor_pos)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static void request_region_mesh_if_ready(s32vec3s region_pos) {
+    if (is_region_ready_to_mesh(region_pos)) {
+        add_to_region_slot_list(&regions_to_mesh, get_region_slot_position(region_pos));
+    }
+}
+
+// Diagonal neighbors included, since the apron's edges and corners come from them
+static void request_region_and_neighbor_meshes_if_ready(s32vec3s region_pos) {
+    for (s32 x = -1; x <= 1; x++) {
+        for (s32 y = -1; y <= 1; y++) {
+            for (s32 z = -1; z <= 1; z++) {
+                request_region_mesh_if_ready((s32vec3s) {{ region_pos.x + x, region_pos.y + y, region_pos.z + z }});
+            }
+        }
+    }
+}
+
+static void unload_region(u32vec3s region_slot_pos) {
+    REGION_TYPE_3D(voxel_type_array_t) voxel_type_arrays = REGION_CAST_3D(voxel_type_array_t, region_voxel_type_arrays);
+	REGION_TYPE_3D(region_render_info_t) render_infos = REGION_CAST_3D(region_render_info_t, region_render_infos);
+
+    region_slot_t* slot = &region_slots[get_region_slot_index(region_slot_pos)];
+    slot->generation_epoch++;
+    slot->mesh_epoch++;
+    if (slot->loaded) {
+        slot->loaded = false;
+        num_unloaded_regions++;
+    }
+
+    // gfx_update_video waits on GX_DrawDone at the end of every frame, so the old display lists are no longer being read here
+    free_voxel_type_array(&(*voxel_type_arrays)[region_slot_pos.x][region_slot_pos.y][region_slot_pos.z]);
+    free_voxel_light_array(&region_voxel_light_arrays[get_region_slot_index(region_slot_pos)]);
+    free_region_visuals(&(*render_infos)[region_slot_pos.x][region_slot_pos.y][region_slot_pos.z]);
+
+    add_to_region_slot_list(&regions_to_generate, region_slot_pos);
+}
+
+static void log_voxel_type_bytes(void) {
+    size_t num_voxel_type_bytes = 0;
+    size_t num_voxel_light_bytes = 0;
+    for (size_t i = 0; i < get_num_regions(); i++) {
+        num_voxel_type_bytes += get_voxel_type_array_num_bytes(&region_voxel_type_arrays[i]);
+        num_voxel_light_bytes += get_voxel_light_array_num_bytes(&region_voxel_light_arrays[i]);
+    }
+    lprintf("Region size: %dx%dx%d\nVoxel layout: %s\nBGT: %d\nNum voxel type bytes: %d\nNum voxel light bytes: %d\n", REGION_SIZE_X, REGION_SIZE_Y, REGION_SIZE_Z, VOXEL_LAYOUT_NAME, total_procedural_gen_time, (u32) num_voxel_type_bytes, (u32) num_voxel_light_bytes);
+}
+
+static void publish_finished_region_jobs(void) {
+    region_job_t job;
+    while (pop_finished_region_job(&job)) {
+        size_t index = get_region_slot_index(job.region_slot_pos);
+        region_slot_t* slot = &region_slots[index];
+
+        switch (job.type) {
+            case region_job_type_generate:
+                total_procedural_gen_time += job.time;
+                if (job.epoch != slot->generation_epoch) {
+                    free_voxel_type_array(&job.voxel_types);
+                    free_voxel_light_array(&job.lights);
+                    break;
+                }
+
+                // The slot's arrays were freed when the slot was unloaded, so the job's arrays are moved in
+                region_voxel_type_arrays[index] = job.voxel_types;
+                region_voxel_light_arrays[index] = job.lights;
+                slot->loaded = true;
+                light_region_borders(job.region_pos, job.above_sky_lights);
+                if (--num_unloaded_regions == 0) {
+                    log_voxel_type_bytes();
+                }
+
+                // The old border regions around this one were meshed without it, so they are remeshed as well
+                request_region_and_neighbor_meshes_if_ready(job.region_pos);
+                break;
+            case region_job_type_mesh:
+                last_visual_gen_time = job.time;
+                total_visual_gen_time += job.time;
+                if (job.epoch != slot->mesh_epoch) {
+                    free_region_visuals(&job.render_info);
+                    break;
+                }
+
+                // Safe for the same reason as in unload_region
+                free_region_visuals(&region_render_infos[index]);
+                region_render_infos[index] = job.render_info;
+                break;
+        }
+    }
+}
+
+static void push_region_jobs(void) {
+    size_t num_pushed = 0;
+    for (; num_pushed < regions_to_generate.num_slot_positions; num_pushed++) {
+        u32vec3s region_slot_pos = regions_to_generate.slot_positions[num_pushed];
+        region_job_t job = {
+            .type = region_job_type_generate,
+            .region_pos = get_region_position_from_slot_position(region_slot_pos),
+            .region_slot_pos = region_slot_pos,
+            .epoch = region_slots[get_region_slot_index(region_slot_pos)].generation_epoch
+        };
+        get_region_above_sky_lights(job.region_pos, job.above_sky_lights);
+        if (!push_region_job(&job)) {
+            break;
+        }
+    }
+    remove_front_of_region_slot_list(&regions_to_generate, num_pushed);
+
+    num_pushed = 0;
+    for (; num_pushed < regions_to_mesh.num_slot_positions; num_pushed++) {
+        u32vec3s region_slot_pos = regions_to_mesh.slot_positions[num_pushed];
+        region_slot_t* slot = &region_slots[get_region_slot_index(region_slot_pos)];
+        if (!slot->loaded) {
+            continue;
+        }
+
+        s32vec3s region_pos = get_region_position_from_slot_position(region_slot_pos);
+        region_job_t job = {
+            .type = region_job_type_mesh,
+            .region_pos = region_pos,
+            .region_slot_pos = region_slot_pos,
+            .epoch = slot->mesh_epoch + 1
+        };
+
+        // The worker meshes copies so that the region and its neighbors can be edited or unloaded in the meantime
+        copy_voxel_type_array(&job.voxel_types, get_voxel_type_array_from_region_position(region_pos));
+        copy_voxel_light_array(&job.lights, get_voxel_light_array_from_region_position(region_pos));
+        // Ordered by voxel_face_t
+        const s32vec3s neighbor_offsets[6] = { {{ 1, 0, 0 }}, {{ -1, 0, 0 }}, {{ 0, 1, 0 }}, {{ 0, -1, 0 }}, {{ 0, 0, 1 }}, {{ 0, 0, -1 }} };
+        for (size_t i = 0; i < 6; i++) {
+            const voxel_type_array_t* neighbor_voxel_types = get_voxel_type_array_from_region_position((s32vec3s) {{
+                region_pos.x + neighbor_offsets[i].x,
+                region_pos.y + neighbor_offsets[i].y,
+                region_pos.z + neighbor_offsets[i].z
+            }});
+            if (neighbor_voxel_types != NULL) {
+                copy_voxel_type_array(&job.neighbor_voxel_types[i], neighbor_voxel_types);
+                // Loaded along with the voxel types
+                copy_voxel_light_array(&job.neighbor_lights[i], get_voxel_light_array_from_region_position((s32vec3s) {{
+                    region_pos.x + neighbor_offsets[i].x,
+                    region_pos.y + neighbor_offsets[i].y,
+                    region_pos.z + neighbor_offsets[i].z
+                }}));
+                job.has_neighbor_voxel_types[i] = true;
+            }
+        }
+        copy_apron_edges_of_region(region_pos, &job.apron_edges);
+
+        if (!push_region_job(&job)) {
+            free_voxel_type_array(&job.voxel_types);
+            free_voxel_light_array(&job.lights);
+            for (size_t i = 0; i < 6; i++) {
+                free_voxel_type_array(&job.neighbor_voxel_types[i]);
+                free_voxel_light_array(&job.neighbor_lights[i]);
+            }
+            break;
+        }
+        slot->mesh_epoch = job.epoch;
     }
-    return (*voxel_type_arrays)[region_rel_pos.x][region_rel_pos.y][region_rel_pos.z];
+    remove_front_of_region_slot_list(&regions_to_mesh, num_pushed);
 }
 
-void init_region_management(void) {
-    world_size = 6;
-    region_voxel_type_arrays = malloc(get_num_regions() * sizeof(voxel_type_array_t*));
+static s32vec3s initial_region_center;
+
+static s32 get_initial_region_distance_squared(const u32vec3s* region_slot_pos) {
+    s32vec3s region_pos = get_region_position_from_slot_position(*region_slot_pos);
+    s32 dx = region_pos.x - initial_region_center.x;
+    s32 dy = region_pos.y - initial_region_center.y;
+    s32 dz = region_pos.z - initial_region_center.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+static int compare_initial_region_distances(const void* a, const void* b) {
+    return get_initial_region_distance_squared(a) - get_initial_region_distance_squared(b);
+}
+
+// Width of the loaded regions in voxels along every axis, so that every region size loads about the same volume around the camera
+#define LOADED_WORLD_WIDTH 96
+
+void init_region_management(s32vec3s region_pos) {
+    world_size = (u32vec3s) {{
+        (LOADED_WORLD_WIDTH + REGION_SIZE_X - 1) / REGION_SIZE_X,
+        (LOADED_WORLD_WIDTH + REGION_SIZE_Y - 1) / REGION_SIZE_Y,
+        (LOADED_WORLD_WIDTH + REGION_SIZE_Z - 1) / REGION_SIZE_Z
+    }};
+    corner_region_pos = (s32vec3s) {{
+        region_pos.x - (s32) (world_size.x / 2),
+        region_pos.y - (s32) (world_size.y / 2),
+        region_pos.z - (s32) (world_size.z / 2)
+    }};
+
+    region_voxel_type_arrays = malloc(get_num_regions() * sizeof(*region_voxel_type_arrays));
+    region_voxel_light_arrays = malloc(get_num_regions() * sizeof(*region_voxel_light_arrays));
     region_render_infos = malloc(get_num_regions() * sizeof(*region_render_infos));
+    region_slots = malloc(get_num_regions() * sizeof(*region_slots));
 
-    memset(region_voxel_type_arrays, 0, get_num_regions() * sizeof(voxel_type_array_t*));
+    memset(region_voxel_type_arrays, 0, get_num_regions() * sizeof(*region_voxel_type_arrays));
+    memset(region_voxel_light_arrays, 0, get_num_regions() * sizeof(*region_voxel_light_arrays));
     memset(region_render_infos, 0, get_num_regions() * sizeof(*region_render_infos));
+    memset(region_slots, 0, get_num_regions() * sizeof(*region_slots));
+    for (size_t i = 0; i < get_num_regions(); i++) {
+        // Resets the face connections
+        free_region_visuals(&region_render_infos[i]);
+    }
+    num_unloaded_regions = get_num_regions();
+
+    init_region_slot_list(&dirty_regions);
+    init_region_slot_list(&light_dirty_regions);
+    init_region_slot_list(&regions_to_generate);
+    init_region_slot_list(&regions_to_mesh);
+
+    // Every region is generated on the region worker, starting with the ones closest to the camera
+	for (u32 x = 0; x < world_size.x; x++) {
+		for (u32 y = 0; y < world_size.y; y++) {
+			for (u32 z = 0; z < world_size.z; z++) {
+                add_to_region_slot_list(&regions_to_generate, (u32vec3s) {{ x, y, z }});
+            }
+        }
+    }
+    initial_region_center = region_pos;
+    qsort(regions_to_generate.slot_positions, regions_to_generate.num_slot_positions, sizeof(*regions_to_generate.slot_positions), compare_initial_region_distances);
+
+    init_region_worker();
+    push_region_jobs();
+}
+
+void update_region_jobs(void) {
+    publish_finished_region_jobs();
+    push_region_jobs();
+}
+
+static const char* region_vertex_format_names[NUM_REGION_VERTEX_FORMATS] = { "direct", "indexed", "tex gen" };
 
+void regenerate_region_visuals(void) {
     for (size_t i = 0; i < get_num_regions(); i++) {
-        region_voxel_type_arrays[i] = malloc(sizeof(*region_voxel_type_arrays[i]));
+        free_region_visuals(&region_render_infos[i]);
     }
-    
-	REGION_TYPE_3D(voxel_type_array_t*) voxel_type_arrays = REGION_CAST_3D(voxel_type_array_t*, region_voxel_type_arrays);
-	REGION_TYPE_3D(region_render_info_t) render_infos = REGION_CAST_3D(region_render_info_t, region_render_infos);
 
-	for (u32 x = 0; x < world_size; x++) {
-		for (u32 y = 0; y < world_size; y++) {
-			for (u32 z = 0; z < world_size; z++) {
-                s32vec3s region_pos = get_region_position((u32vec3s) {{ x, y, z }});
+    total_visual_gen_time = 0;
+    generate_visuals_for_all_regions();
+
+    size_t num_display_list_bytes = 0;
+    for (size_t i = 0; i < get_num_regions(); i++) {
+        num_display_list_bytes += get_region_visuals_num_bytes(&region_render_infos[i]);
+    }
+    lprintf("Mesher: %s\nVertex format: %s\nMGT: %d\nNum display list bytes: %d\n", region_mesher == region_mesher_greedy ? "greedy" : "per face", region_vertex_format_names[region_vertex_format], total_visual_gen_time, (u32) num_display_list_bytes);
+    log_display_list_pool_stats();
+    log_region_mesh_cache_stats();
+}
+
+void update_dirty_region_visuals(void) {
+    for (size_t i = 0; i < dirty_regions.num_slot_positions; i++) {
+        u32vec3s region_slot_pos = dirty_regions.slot_positions[i];
+        if (!region_slots[get_region_slot_index(region_slot_pos)].loaded) {
+            continue;
+        }
+
+        // Safe for the same reason as in unload_region
+        free_region_visuals(&region_render_infos[get_region_slot_index(region_slot_pos)]);
+        generate_visuals_for_region(region_slot_pos);
+    }
+    remove_front_of_region_slot_list(&dirty_regions, dirty_regions.num_slot_positions);
+
+    // Regions would otherwise be meshed again for every frame that the light is still spreading through them
+    if (is_light_spreading()) {
+        return;
+    }
+    for (size_t i = 0; i < light_dirty_regions.num_slot_positions; i++) {
+        request_region_mesh_if_ready(get_region_position_from_slot_position(light_dirty_regions.slot_positions[i]));
+    }
+    remove_front_of_region_slot_list(&light_dirty_regions, light_dirty_regions.num_slot_positions);
+}
+
+void manage_regions(s32vec3s last_region_pos, s32vec3s region_pos) {
+    if (last_region_pos.x == region_pos.x && last_region_pos.y == region_pos.y && last_region_pos.z == region_pos.z) {
+        return;
+    }
 
-                voxel_type_array_t* voxel_types = (*voxel_type_arrays)[x][y][z];
-                generate_region_voxels(region_pos, voxel_types);
+    s32vec3s last_corner_region_pos = corner_region_pos;
+    corner_region_pos = (s32vec3s) {{
+        region_pos.x - (s32) (world_size.x / 2),
+        region_pos.y - (s32) (world_size.y / 2),
+        region_pos.z - (s32) (world_size.z / 2)
+    }};
+
+    // Only the slots of regions that left the window are regenerated, every other region stays where it is
+	for (u32 x = 0; x < world_size.x; x++) {
+		for (u32 y = 0; y < world_size.y; y++) {
+			for (u32 z = 0; z < world_size.z; z++) {
+                u32vec3s region_slot_pos = {{ x, y, z }};
+                s32vec3s new_region_pos = get_region_position_from_slot_position(region_slot_pos);
+
+                u32vec3s last_region_rel_pos = {{
+                    (u32) (new_region_pos.x - last_corner_region_pos.x),
+                    (u32) (new_region_pos.y - last_corner_region_pos.y),
+                    (u32) (new_region_pos.z - last_corner_region_pos.z)
+                }};
+                if (!is_region_relative_position_out_of_bounds(last_region_rel_pos)) {
+                    continue;
+                }
+
+                unload_region(region_slot_pos);
+                num_streamed_regions++;
             }
         }
     }
 
-	for (u32 x = 0; x < world_size; x++) {
-		for (u32 y = 0; y < world_size; y++) {
-			for (u32 z = 0; z < world_size; z++) {
-                const voxel_type_array_t* voxel_types = (*voxel_type_arrays)[x][y][z];
-                region_render_info_t* render_info = &(*render_infos)[x][y][z];
-
-                generate_region_visuals(
-                    voxel_types,
-                    get_neighbor_voxel_type_array((u32vec3s) {{ x + 1u, y, z }}), 
-                    get_neighbor_voxel_type_array((u32vec3s) {{ x - 1u, y, z }}), 
-                    get_neighbor_voxel_type_array((u32vec3s) {{ x, y + 1u, z }}), 
-                    get_neighbor_voxel_type_array((u32vec3s) {{ x, y - 1u, z }}), 
-                    get_neighbor_voxel_type_array((u32vec3s) {{ x, y, z + 1u }}), 
-                    get_neighbor_voxel_type_array((u32vec3s) {{ x, y, z - 1u }}), 
-                    render_info
-                );
+    // The regions that are now on the border were meshed with the regions that left the window next to them, so they are remeshed without them
+	for (u32 x = 0; x < world_size.x; x++) {
+		for (u32 y = 0; y < world_size.y; y++) {
+			for (u32 z = 0; z < world_size.z; z++) {
+                s32vec3s left_region_pos = {{
+                    last_corner_region_pos.x + mod_s32((s32) x - last_corner_region_pos.x, (s32) world_size.x),
+                    last_corner_region_pos.y + mod_s32((s32) y - last_corner_region_pos.y, (s32) world_size.y),
+                    last_corner_region_pos.z + mod_s32((s32) z - last_corner_region_pos.z, (s32) world_size.z)
+                }};
+                if (is_region_relative_position_out_of_bounds(get_region_relative_position(left_region_pos))) {
+                    request_region_and_neighbor_meshes_if_ready(left_region_pos);
+                }
             }
         }
     }
 }
-
-void manage_regions(s32vec3s, s32vec3s) {
-    
-}
\ No newline at end of file
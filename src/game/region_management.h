@@ -1,12 +1,40 @@
 #pragma once
+#include "game/region.h"
 #include "game/voxel.h"
 #include "game_math.h"
 
-void init_region_management(void);
+// Regions that entered the window and were generated since init_region_management, not counting the initial ones
+extern u32 num_streamed_regions;
+
+void init_region_management(s32vec3s region_pos);
+// Unloads the regions that left the window around region_pos and queues the newly exposed ones for generation
 void manage_regions(s32vec3s last_region_pos, s32vec3s region_pos);
+// Publishes the regions finished by the region worker and hands it more work, should be called once per frame before drawing
+void update_region_jobs(void);
+// Frees and rebuilds the meshes of every loaded region, e.g. after switching region_mesher or region_vertex_format
+void regenerate_region_visuals(void);
+// Remeshes only the regions touched by voxel edits since the last call, should be called once per frame before drawing.
+// Regions whose light changed are handed to the region worker instead, once update_region_lighting has finished spreading the light.
+void update_dirty_region_visuals(void);
 
 u32vec3s get_region_relative_position(s32vec3s region_pos);
 bool is_region_relative_position_out_of_bounds(u32vec3s region_rel_pos);
+// Regions are stored toroidally in region_voxel_type_arrays, region_voxel_light_arrays and region_render_infos, indexed by their position modulo world_size
+u32vec3s get_region_slot_position(s32vec3s region_pos);
+s32vec3s get_region_position_from_slot_position(u32vec3s region_slot_pos);
+// Index of a slot into region_voxel_type_arrays, region_voxel_light_arrays and region_render_infos
+size_t get_region_slot_index(u32vec3s region_slot_pos);
+
+// Returns NULL if the region is not loaded
+const voxel_type_array_t* get_voxel_type_array_from_region_position(s32vec3s region_pos);
+// Returns NULL if the region is not loaded
+voxel_light_array_t* get_voxel_light_array_from_region_position(s32vec3s region_pos);
 
-// Returns NULL if there is no valid voxel at the given voxel world position
-voxel_type_t* get_voxel_type_from_voxel_world_position(s32vec3s voxel_world_pos);
\ No newline at end of file
+// Fails if there is no valid voxel at the given voxel world position
+voxel_type_wrap_t get_voxel_type_from_voxel_world_position(s32vec3s voxel_world_pos);
+// Returns false if there is no valid voxel at the given voxel world position
+bool set_voxel_type_at_voxel_world_position(s32vec3s voxel_world_pos, voxel_type_t type);
+// Queues the regions that show the voxel at the given voxel world position to be remeshed by update_dirty_region_visuals, e.g. after its type changed
+void mark_regions_dirty_from_voxel_world_position(s32vec3s voxel_world_pos);
+// Queues the regions that show the voxel at the given voxel world position to be remeshed on the region worker once the light has finished spreading, after its light changed
+void mark_region_lights_dirty_from_voxel_world_position(s32vec3s voxel_world_pos);
\ No newline at end of file
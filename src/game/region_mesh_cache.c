@@ -0,0 +1,113 @@
+#include "region_mesh_cache.h"
+#include "game/region_visual_generation.h"
+#include "log.h"
+#include <stdlib.h>
+#include <ogc/mutex.h>
+
+// Only regions that are loaded hold on to entries, so there are rarely more entries than buckets
+#define NUM_REGION_MESH_CACHE_BUCKETS 256
+
+struct region_mesh_cache_entry {
+    // Next entry in the same bucket
+    region_mesh_cache_entry_t* next;
+    u64 hash;
+    u32 num_refs;
+    // Copied into every region sharing the entry
+    region_mesh_t mesh;
+};
+
+static region_mesh_cache_entry_t* buckets[NUM_REGION_MESH_CACHE_BUCKETS];
+
+static region_mesh_cache_stats_t stats;
+
+// Regions are meshed on both the region worker and the main thread
+static mutex_t cache_mutex;
+
+void init_region_mesh_cache(void) {
+    LWP_MutexInit(&cache_mutex, false);
+}
+
+static region_mesh_cache_entry_t** get_bucket(u64 hash) {
+    return &buckets[hash % NUM_REGION_MESH_CACHE_BUCKETS];
+}
+
+bool share_cached_region_mesh(u64 hash, region_mesh_t* mesh) {
+    LWP_MutexLock(cache_mutex);
+
+    region_mesh_cache_entry_t* entry = *get_bucket(hash);
+    while (entry != NULL && entry->hash != hash) {
+        entry = entry->next;
+    }
+
+    if (entry == NULL) {
+        stats.num_misses++;
+        LWP_MutexUnlock(cache_mutex);
+        return false;
+    }
+
+    entry->num_refs++;
+    *mesh = entry->mesh;
+    mesh->mesh_cache_entry = entry;
+
+    stats.num_hits++;
+    stats.num_saved_bytes += get_region_mesh_num_bytes(mesh);
+
+    LWP_MutexUnlock(cache_mutex);
+    return true;
+}
+
+void add_region_mesh_to_cache(u64 hash, region_mesh_t* mesh) {
+    region_mesh_cache_entry_t* entry = malloc(sizeof(*entry));
+    entry->hash = hash;
+    entry->num_refs = 1;
+    entry->mesh = *mesh;
+    mesh->mesh_cache_entry = entry;
+
+    LWP_MutexLock(cache_mutex);
+
+    // If another thread cached the same mesh meanwhile both entries are kept, lookups just find the newer one
+    region_mesh_cache_entry_t** bucket = get_bucket(hash);
+    entry->next = *bucket;
+    *bucket = entry;
+    stats.num_entries++;
+
+    LWP_MutexUnlock(cache_mutex);
+}
+
+bool release_cached_region_mesh(region_mesh_cache_entry_t* entry) {
+    LWP_MutexLock(cache_mutex);
+
+    if (--entry->num_refs != 0) {
+        LWP_MutexUnlock(cache_mutex);
+        return false;
+    }
+
+    region_mesh_cache_entry_t** link = get_bucket(entry->hash);
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    stats.num_entries--;
+
+    LWP_MutexUnlock(cache_mutex);
+
+    free(entry);
+    return true;
+}
+
+region_mesh_cache_stats_t get_region_mesh_cache_stats(void) {
+    LWP_MutexLock(cache_mutex);
+    region_mesh_cache_stats_t cache_stats = stats;
+    LWP_MutexUnlock(cache_mutex);
+    return cache_stats;
+}
+
+void log_region_mesh_cache_stats(void) {
+    region_mesh_cache_stats_t cache_stats = get_region_mesh_cache_stats();
+    lprintf("Mesh cache entries: %d\nMesh cache hits: %d\nMesh cache misses: %d\nMesh cache bytes saved: %d\n",
+        (u32) cache_stats.num_entries,
+        cache_stats.num_hits,
+        cache_stats.num_misses,
+        (u32) cache_stats.num_saved_bytes
+    );
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include "game/region.h"
+#include <gctypes.h>
+
+// Regions with the same voxels and the same neighboring border voxels get byte identical display lists.
+// Those are only generated once and then shared through this cache, which is safe since every region is drawn with its own model view matrix.
+
+typedef struct {
+    // Meshes that are currently shared by at least one region
+    size_t num_entries;
+    // Regions that shared an existing mesh instead of generating their own
+    u32 num_hits;
+    u32 num_misses;
+    // Display list and vertex array bytes that hits didn't have to allocate
+    size_t num_saved_bytes;
+} region_mesh_cache_stats_t;
+
+// Must be called before any region is meshed
+void init_region_mesh_cache(void);
+// Shares the mesh cached under hash into the empty mesh and returns true, or returns false if nothing is cached under hash.
+// Safe to call from any thread.
+bool share_cached_region_mesh(u64 hash, region_mesh_t* mesh);
+// Caches the mesh that was just generated under hash, it becomes the first one sharing the entry.
+// Safe to call from any thread.
+void add_region_mesh_to_cache(u64 hash, region_mesh_t* mesh);
+// Drops a region's share of its cached mesh, returns true if it was the last one so that the caller has to free the mesh.
+// Safe to call from any thread.
+bool release_cached_region_mesh(region_mesh_cache_entry_t* entry);
+
+region_mesh_cache_stats_t get_region_mesh_cache_stats(void);
+void log_region_mesh_cache_stats(void);
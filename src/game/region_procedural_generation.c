@@ -24,9 +24,9 @@ static f32 get_tallgrass_value(vec2s position) {
     );
 }
 
-static void generate_high_voxels(s32vec3s, voxel_type_array_t* voxel_types) {
-    memset(voxel_types->types, voxel_type_air, sizeof(voxel_types->types));
-}
+// Voxels are generated uncompressed here and then packed into the region's voxel type array.
+// This makes generation non-reentrant, which is fine since only the region worker thread generates voxels.
+static voxel_type_t generated_types[REGION_SIZE_X][REGION_SIZE_Y][REGION_SIZE_Z];
 
 voxel_type_t get_voxel_type_at_position(s32 y, s32 gen_y, f32 tallgrass_value) {
     if (y > gen_y) {
@@ -53,12 +53,27 @@ voxel_type_t get_voxel_type_at_position(s32 y, s32 gen_y, f32 tallgrass_value) {
     return voxel_type_grass;
 }
 
-static void generate_middle_voxels(s32vec3s region_pos, voxel_type_array_t* voxel_types) {
-    f32 x_offset = (f32) region_pos.x * REGION_SIZE;
-    f32 world_region_z = (f32) region_pos.z * REGION_SIZE;
+// Terrain is only generated between these world heights, with stone below and air above, so that it is the same for every region size
+#define TERRAIN_BEGIN_Y 0
+#define TERRAIN_END_Y 16
 
-    for (s32 x = 0; x < REGION_SIZE; x++) {
-        for (s32 z = 0; z < REGION_SIZE; z++) {
+static voxel_type_t get_terrain_voxel_type(s32 y, s32 gen_y, f32 tallgrass_value) {
+    if (y < TERRAIN_BEGIN_Y) {
+        return voxel_type_stone;
+    }
+    if (y >= TERRAIN_END_Y) {
+        return voxel_type_air;
+    }
+    return get_voxel_type_at_position(y, gen_y, tallgrass_value);
+}
+
+static void generate_middle_voxels(s32vec3s region_pos) {
+    f32 x_offset = (f32) region_pos.x * REGION_SIZE_X;
+    s32 world_region_y = region_pos.y * REGION_SIZE_Y;
+    f32 world_region_z = (f32) region_pos.z * REGION_SIZE_Z;
+
+    for (s32 x = 0; x < REGION_SIZE_X; x++) {
+        for (s32 z = 0; z < REGION_SIZE_Z; z++) {
             vec2s noise_pos = { .x = x_offset + (f32) x, .y = world_region_z + (f32) z };
 
             f32 height = get_hills_height(noise_pos);
@@ -67,24 +82,23 @@ static void generate_middle_voxels(s32vec3s region_pos, voxel_type_array_t* voxe
 
             s32 gen_y = (s32) (height * 12) + 1;
 
-            for (s32 y = 0; y < REGION_SIZE; y++) {
-                voxel_type_t* type = &voxel_types->types[(size_t) x][(size_t) y][(size_t) z];
-                *type = get_voxel_type_at_position(y, gen_y, tallgrass_value);
+            for (s32 y = 0; y < REGION_SIZE_Y; y++) {
+                voxel_type_t* type = &generated_types[(size_t) x][(size_t) y][(size_t) z];
+                *type = get_terrain_voxel_type(world_region_y + y, gen_y, tallgrass_value);
             }
         }
     }
 }
 
-static void generate_low_voxels(s32vec3s, voxel_type_array_t* voxel_types) {
-    memset(voxel_types->types, voxel_type_stone, sizeof(voxel_types->types));
-}
-
 void generate_region_voxels(s32vec3s pos, voxel_type_array_t* voxel_types) {
-    if (pos.y > 0) {
-        generate_high_voxels(pos, voxel_types);
-    } else if (pos.y < 0) {
-        generate_low_voxels(pos, voxel_types);
+    // Regions above and below the terrain are a single type, so they are stored as uniform regions without generating any voxels
+    s32 world_region_y = pos.y * REGION_SIZE_Y;
+    if (world_region_y >= TERRAIN_END_Y) {
+        init_uniform_voxel_type_array(voxel_types, voxel_type_air);
+    } else if (world_region_y + REGION_SIZE_Y <= TERRAIN_BEGIN_Y) {
+        init_uniform_voxel_type_array(voxel_types, voxel_type_stone);
     } else {
-        generate_middle_voxels(pos, voxel_types);
+        generate_middle_voxels(pos);
+        init_voxel_type_array(voxel_types, generated_types);
     }
 }
\ No newline at end of file
@@ -1,74 +1,586 @@
 #include "region_rendering.h"
+#include "asset.h"
 #include "game/display_list.h"
 #include "game/region.h"
+#include "game/region_management.h"
+#include "game/region_visual_generation.h"
+#include "game/camera.h"
+#include "game/voxel.h"
 #include "log.h"
 #include <cglm/struct/affine.h>
 #include <cglm/struct/mat4.h>
+#include <cglm/struct/vec3.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/cache.h>
 #include <ogc/gu.h>
 #include <ogc/gx.h>
 
-static void call_display_lists(const mat4s* view, size_t display_list_array_index) {
-	REGION_TYPE_3D(region_render_info_t) render_infos = REGION_CAST_3D(region_render_info_t, region_render_infos);
+typedef struct {
+	// The mesh of the level of detail that the region is drawn with this frame
+	const region_mesh_t* mesh;
+	s32vec3s region_pos;
+	// Computed once per frame and loaded by every pass that draws the region
+	mat4s model_view;
+} visible_region_t;
 
-	for (size_t x = 0; x < world_size; x++) {
-		for (size_t y = 0; y < world_size; y++) {
-			for (size_t z = 0; z < world_size; z++) {
-				const region_render_info_t* info = &(*render_infos)[x][y][z];
-				const region_display_list_array_t* display_list_array = &info->display_list_arrays[display_list_array_index];
-				
-				mat4s model;
-				guMtxIdentity(model.raw);
-				guMtxTransApply(model.raw, model.raw, (f32) (x * REGION_SIZE), (f32) (y * REGION_SIZE), (f32) (z * REGION_SIZE));
-				
-				mat4s model_view;
-				guMtxConcat(view->raw, model.raw, model_view.raw);
+// Regions with display lists reached by the walk in update_visible_regions this frame, ordered front to back, shared by every pass in draw_regions
+static visible_region_t* visible_regions;
+static size_t num_visible_regions;
 
-				GX_LoadPosMtxImm(model_view.raw, REGION_MATRIX_INDEX);
+u32 num_drawn_regions;
+u32 num_culled_regions;
+bool region_stats_enabled;
+u32 num_bytes_per_region[NUM_REGION_VERTEX_FORMATS];
+u32 num_drawn_regions_per_lod[NUM_REGION_LODS];
 
-				for (size_t i = 0; i < display_list_array->num_display_lists; i++) {
-					const display_list_t* display_list = &display_list_array->display_lists[i];
+bool region_lods_enabled = true;
 
-					GX_CallDispList((void*) display_list->data, display_list->num_bytes);
+GXColor region_sky_light_color = { 0xff, 0xff, 0xff, 0xff };
+
+// Indexed by the sky and block shades of each vertex, filled in by init_region_rendering
+alignas(32) static GXColor region_shade_colors[NUM_REGION_SHADES];
+
+// Indexed by ambient occlusion, the darkest is for vertices in a corner with all three voxels touching it opaque
+static const f32 region_ao_brightnesses[NUM_REGION_AO_LEVELS] = { 0.5f, 0.65f, 0.8f, 1.0f };
+// Each light level is this much darker than the one above it, so that light fades out smoothly towards 0
+#define LIGHT_LEVEL_FALLOFF 0.8f
+
+// Regions whose centers are further from the camera than the loaded window's radius, i.e. those towards its corners, are drawn with their first downsampled mesh.
+// Each further level starts this many times further out than the one before.
+#define REGION_LOD_DISTANCE_SCALE 1.25f
+
+// Half the width of the loaded window along its narrowest axis in voxels, set by init_region_rendering
+static f32 region_lod_distance;
+
+typedef struct {
+	vec3s normal;
+	f32 distance;
+} plane_t;
+
+// Planes of the camera frustum with normals pointing inwards, so a point is inside a plane if dot(normal, point) + distance >= 0
+static plane_t frustum_planes[6];
+
+static plane_t get_plane(vec3s normal, vec3s point) {
+	return (plane_t) {
+		.normal = normal,
+		.distance = -glms_vec3_dot(normal, point)
+	};
+}
+
+static void update_frustum_planes(void) {
+	vec3s forward = glms_vec3_normalize(cam_forward);
+	vec3s right = glms_vec3_normalize(glms_vec3_cross(forward, cam_up));
+	vec3s up = glms_vec3_cross(right, forward);
+
+	// fov is the vertical field of view in degrees, as passed to guPerspective
+	f32 tan_half_fov_y = tanf(glm_rad(fov) / 2.0f);
+	f32 tan_half_fov_x = tan_half_fov_y * aspect;
+
+	vec3s forward_x = glms_vec3_scale(forward, tan_half_fov_x);
+	vec3s forward_y = glms_vec3_scale(forward, tan_half_fov_y);
+
+	frustum_planes[0] = get_plane(glms_vec3_sub(forward_x, right), cam_position);
+	frustum_planes[1] = get_plane(glms_vec3_add(forward_x, right), cam_position);
+	frustum_planes[2] = get_plane(glms_vec3_sub(forward_y, up), cam_position);
+	frustum_planes[3] = get_plane(glms_vec3_add(forward_y, up), cam_position);
+	frustum_planes[4] = get_plane(forward, glms_vec3_add(cam_position, glms_vec3_scale(forward, near_clipping_plane_distance)));
+	frustum_planes[5] = get_plane(glms_vec3_negate(forward), glms_vec3_add(cam_position, glms_vec3_scale(forward, far_clipping_plane_distance)));
+}
+
+// Only the corner of the box furthest along each plane's normal has to be checked
+static bool is_box_in_frustum(vec3s begin, vec3s end) {
+	for (size_t i = 0; i < 6; i++) {
+		const plane_t* plane = &frustum_planes[i];
+		vec3s corner = {
+			.x = plane->normal.x >= 0.0f ? end.x : begin.x,
+			.y = plane->normal.y >= 0.0f ? end.y : begin.y,
+			.z = plane->normal.z >= 0.0f ? end.z : begin.z
+		};
+		if (glms_vec3_dot(plane->normal, corner) + plane->distance < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool does_region_mesh_have_display_lists(const region_mesh_t* mesh) {
+	for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+		if (mesh->display_list_arrays[i].num_display_lists > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool does_region_have_display_lists(const region_render_info_t* info) {
+	for (size_t i = 0; i < info->num_lod_meshes; i++) {
+		if (does_region_mesh_have_display_lists(&info->lod_meshes[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+typedef struct {
+	s32vec3s region_pos;
+	// The face of this region the walk entered through, or NO_ENTRY_FACE for the camera's region
+	u8 entry_face;
+	// Bitmask of the directions the walk has taken to get here, ordered by voxel_face_t
+	u8 walked_directions;
+} region_walk_step_t;
+
+#define NO_ENTRY_FACE 6
+
+// Breadth first walk state, indexed like region_render_infos
+static region_walk_step_t* region_walk_queue;
+static bool* walked_regions;
+
+// Slot indices ordered by the distance of their regions to the camera.
+// Kept between frames, since the order barely changes while the camera moves.
+static size_t* sorted_region_slot_indices;
+// Squared distances from the camera to the center of each slot's region, indexed like region_render_infos
+static f32* region_distances;
+
+static s32vec3s get_face_neighbor_region_position(voxel_face_t face, s32vec3s region_pos) {
+	switch (face) {
+		default:
+		case voxel_face_front: region_pos.x++; break;
+		case voxel_face_back: region_pos.x--; break;
+		case voxel_face_top: region_pos.y++; break;
+		case voxel_face_bottom: region_pos.y--; break;
+		case voxel_face_right: region_pos.z++; break;
+		case voxel_face_left: region_pos.z--; break;
+	}
+	return region_pos;
+}
+
+static bool is_region_in_frustum(s32vec3s region_pos) {
+	vec3s begin = {
+		.x = (f32) (region_pos.x * REGION_SIZE_X),
+		.y = (f32) (region_pos.y * REGION_SIZE_Y),
+		.z = (f32) (region_pos.z * REGION_SIZE_Z)
+	};
+	vec3s end = glms_vec3_add(begin, (vec3s) {{ REGION_SIZE_X, REGION_SIZE_Y, REGION_SIZE_Z }});
+	return is_box_in_frustum(begin, end);
+}
+
+// distance2 is the squared distance from the camera to the region's center
+static u8 get_region_lod(const region_render_info_t* info, f32 distance2) {
+	u8 lod = 0;
+	if (!region_lods_enabled) {
+		return lod;
+	}
+
+	f32 lod_distance = region_lod_distance;
+	while (lod + 1 < info->num_lod_meshes && distance2 > lod_distance * lod_distance) {
+		lod++;
+		lod_distance *= REGION_LOD_DISTANCE_SCALE;
+	}
+	return lod;
+}
+
+static void add_visible_region(const mat4s* view, const region_render_info_t* info, s32vec3s region_pos, f32 distance2) {
+	u8 lod = get_region_lod(info, distance2);
+	const region_mesh_t* mesh = &info->lod_meshes[lod];
+	if (!does_region_mesh_have_display_lists(mesh)) {
+		return;
+	}
+	num_drawn_regions_per_lod[lod]++;
+
+	mat4s model;
+	guMtxIdentity(model.raw);
+	guMtxTransApply(model.raw, model.raw, (f32) (region_pos.x * REGION_SIZE_X), (f32) (region_pos.y * REGION_SIZE_Y), (f32) (region_pos.z * REGION_SIZE_Z));
+
+	visible_region_t* visible_region = &visible_regions[num_visible_regions++];
+	visible_region->mesh = mesh;
+	visible_region->region_pos = region_pos;
+	guMtxConcat(view->raw, model.raw, visible_region->model_view.raw);
+}
+
+static void update_region_stats(void) {
+	u32 num_regions_with_display_lists = 0;
+	u32 num_regions[NUM_REGION_VERTEX_FORMATS] = { 0 };
+	size_t num_bytes[NUM_REGION_VERTEX_FORMATS] = { 0 };
+	for (size_t i = 0; i < get_num_regions(); i++) {
+		const region_render_info_t* info = &region_render_infos[i];
+		if (!does_region_have_display_lists(info)) {
+			continue;
+		}
+		num_regions_with_display_lists++;
+
+		region_vertex_format_t vertex_format = info->lod_meshes[0].vertex_format;
+		num_regions[vertex_format]++;
+		num_bytes[vertex_format] += get_region_visuals_num_bytes(info);
+	}
+
+	num_culled_regions = num_regions_with_display_lists - num_drawn_regions;
+	for (size_t i = 0; i < NUM_REGION_VERTEX_FORMATS; i++) {
+		num_bytes_per_region[i] = num_regions[i] == 0 ? 0 : (u32) (num_bytes[i] / num_regions[i]);
+	}
+}
+
+static void sort_regions_by_distance(void) {
+	for (u32 x = 0; x < world_size.x; x++) {
+		for (u32 y = 0; y < world_size.y; y++) {
+			for (u32 z = 0; z < world_size.z; z++) {
+				u32vec3s region_slot_pos = {{ x, y, z }};
+				s32vec3s region_pos = get_region_position_from_slot_position(region_slot_pos);
+				vec3s center = {
+					.x = (f32) (region_pos.x * REGION_SIZE_X) + ((f32) REGION_SIZE_X / 2.0f),
+					.y = (f32) (region_pos.y * REGION_SIZE_Y) + ((f32) REGION_SIZE_Y / 2.0f),
+					.z = (f32) (region_pos.z * REGION_SIZE_Z) + ((f32) REGION_SIZE_Z / 2.0f)
+				};
+				region_distances[get_region_slot_index(region_slot_pos)] = glms_vec3_distance2(center, cam_position);
+			}
+		}
+	}
+
+	// Insertion sort is close to linear on the previous frame's almost sorted order
+	for (size_t i = 1; i < get_num_regions(); i++) {
+		size_t index = sorted_region_slot_indices[i];
+		f32 distance = region_distances[index];
+
+		size_t j = i;
+		for (; j > 0 && region_distances[sorted_region_slot_indices[j - 1]] > distance; j--) {
+			sorted_region_slot_indices[j] = sorted_region_slot_indices[j - 1];
+		}
+		sorted_region_slot_indices[j] = index;
+	}
+}
+
+// Walks outwards from the camera's region, only leaving a region through a face that can be seen from the face the walk entered through.
+// The walk never turns back on a direction it has already taken, so a region is only reached if there is a plausible line of sight to it.
+static void update_visible_regions(const mat4s* view) {
+	update_frustum_planes();
+
+	memset(walked_regions, 0, get_num_regions() * sizeof(*walked_regions));
+
+	s32vec3s camera_region_pos = get_region_position_from_voxel_world_position(get_voxel_world_position(cam_position));
+	if (!is_region_relative_position_out_of_bounds(get_region_relative_position(camera_region_pos))) {
+		size_t head = 0;
+		size_t tail = 0;
+		region_walk_queue[tail++] = (region_walk_step_t) {
+			.region_pos = camera_region_pos,
+			.entry_face = NO_ENTRY_FACE,
+			.walked_directions = 0
+		};
+		walked_regions[get_region_slot_index(get_region_slot_position(camera_region_pos))] = true;
+
+		while (head < tail) {
+			region_walk_step_t step = region_walk_queue[head++];
+			const region_render_info_t* info = &region_render_infos[get_region_slot_index(get_region_slot_position(step.region_pos))];
+
+			for (u8 face = 0; face < 6; face++) {
+				// Opposite faces only differ in the lowest bit
+				if (step.walked_directions & (1u << (face ^ 1))) {
+					continue;
 				}
+				if (step.entry_face != NO_ENTRY_FACE && !(info->face_connections[step.entry_face] & (1u << face))) {
+					continue;
+				}
+
+				s32vec3s neighbor_pos = get_face_neighbor_region_position((voxel_face_t) face, step.region_pos);
+				if (is_region_relative_position_out_of_bounds(get_region_relative_position(neighbor_pos))) {
+					continue;
+				}
+				size_t neighbor_index = get_region_slot_index(get_region_slot_position(neighbor_pos));
+				if (walked_regions[neighbor_index] || !is_region_in_frustum(neighbor_pos)) {
+					continue;
+				}
+				walked_regions[neighbor_index] = true;
+
+				region_walk_queue[tail++] = (region_walk_step_t) {
+					.region_pos = neighbor_pos,
+					.entry_face = face ^ 1,
+					.walked_directions = step.walked_directions | (u8) (1u << face)
+				};
 			}
 		}
 	}
+
+	// Every walked region is visible, they are added in distance order instead of walk order
+	sort_regions_by_distance();
+	num_visible_regions = 0;
+	memset(num_drawn_regions_per_lod, 0, sizeof(num_drawn_regions_per_lod));
+	for (size_t i = 0; i < get_num_regions(); i++) {
+		size_t index = sorted_region_slot_indices[i];
+		if (!walked_regions[index]) {
+			continue;
+		}
+		u32vec3s region_slot_pos = {{
+			(u32) (index / (world_size.y * world_size.z)),
+			(u32) ((index / world_size.z) % world_size.y),
+			(u32) (index % world_size.z)
+		}};
+		add_visible_region(view, &region_render_infos[index], get_region_position_from_slot_position(region_slot_pos), region_distances[index]);
+	}
+
+	num_drawn_regions = (u32) num_visible_regions;
+	if (region_stats_enabled) {
+		update_region_stats();
+	}
+}
+
+// Vertex descriptors of the region attributes as last set by load_visible_region, GX_NONE forces the next one to be set
+static u8 position_vtx_desc;
+static u8 tex_coord_vtx_desc;
+
+static void set_region_vtx_desc(u8 position_type, u8 tex_coord_type) {
+	if (position_type != position_vtx_desc || tex_coord_type != tex_coord_vtx_desc) {
+		GX_SetVtxDesc(GX_VA_POS, position_type);
+		GX_SetVtxDesc(GX_VA_TEX0, tex_coord_type);
+		position_vtx_desc = position_type;
+		tex_coord_vtx_desc = tex_coord_type;
+	}
+}
+
+// Texture coordinates of region_vertex_format_tex_gen are generated from positions, which are in voxels relative to the region.
+// Each tile is its own repeating texture, so the matrices only need to pick the axes of a face that s and t run along, matching face_quad_templates.
+// Indexed by voxel_face_t followed by CROSS_TEX_GEN_FACE.
+static const f32 tex_gen_matrices[CROSS_TEX_GEN_FACE + 1][3][4] = {
+	[voxel_face_front] = { { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f, 0.0f } },
+	[voxel_face_back] = { { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f, 0.0f } },
+	[voxel_face_top] = { { 0.0f, 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f, 0.0f } },
+	[voxel_face_bottom] = { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f, 0.0f } },
+	[voxel_face_right] = { { -1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f, 0.0f } },
+	[voxel_face_left] = { { -1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f, 0.0f } },
+	[CROSS_TEX_GEN_FACE] = { { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f, 0.0f } }
+};
+
+static u32 get_tex_gen_matrix_index(u8 face) {
+	return (u32) (GX_TEXMTX0 + (face * (GX_TEXMTX1 - GX_TEXMTX0)));
+}
+
+// The vertex formats other than region_vertex_format_tex_gen have texture coordinates in tiles along s and in repeats of the texture along t, so that merged faces can repeat it as often as they are long.
+// The atlas has its tiles in a single row, so only s is scaled down to the atlas.
+static const f32 region_atlas_tex_matrix[3][4] = {
+	{ 1.0f / NUM_REGION_TEXTURE_TILES, 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f, 0.0f }
+};
+
+#define REGION_ATLAS_TEX_MATRIX_INDEX get_tex_gen_matrix_index(CROSS_TEX_GEN_FACE + 1)
+
+// Texture tile and face as last set by set_region_tex_gen, NO_TEX_GEN means the texture atlas is loaded and texture coordinates come from the vertices
+#define NO_TEX_GEN 0xff
+static u8 tex_gen_tile;
+static u8 tex_gen_face;
+
+static void set_region_tex_gen(u8 tile, u8 face) {
+	if (tile != tex_gen_tile) {
+		if (tile == NO_TEX_GEN) {
+			load_region_texture();
+		} else {
+			load_region_tile_texture(tile);
+		}
+		tex_gen_tile = tile;
+	}
+	if (face != tex_gen_face) {
+		if (face == NO_TEX_GEN) {
+			GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, REGION_ATLAS_TEX_MATRIX_INDEX);
+		} else {
+			GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_POS, get_tex_gen_matrix_index(face));
+		}
+		tex_gen_face = face;
+	}
+}
+
+// Loads the model view matrix of the region along with the vertex descriptors of its mesh's region_vertex_format_t, and its vertex arrays if it has any
+static void load_visible_region(const visible_region_t* visible_region) {
+	GX_LoadPosMtxImm(visible_region->model_view.raw, REGION_MATRIX_INDEX);
+
+	const region_mesh_t* mesh = visible_region->mesh;
+	const region_vertex_arrays_t* vertex_arrays = &mesh->vertex_arrays;
+	switch (mesh->vertex_format) {
+		default:
+		case region_vertex_format_direct:
+			set_region_vtx_desc(GX_DIRECT, GX_DIRECT);
+			set_region_tex_gen(NO_TEX_GEN, NO_TEX_GEN);
+			break;
+		case region_vertex_format_indexed:
+			set_region_vtx_desc(vertex_arrays->position_index_type, vertex_arrays->tex_coord_index_type);
+			set_region_tex_gen(NO_TEX_GEN, NO_TEX_GEN);
+			GX_SetArray(GX_VA_POS, vertex_arrays->data, 3);
+			GX_SetArray(GX_VA_TEX0, vertex_arrays->data + vertex_arrays->tex_coords_offset, 2);
+			break;
+		case region_vertex_format_tex_gen:
+			// The tile and face are set by each display list
+			set_region_vtx_desc(GX_DIRECT, GX_NONE);
+			break;
+	}
+}
+
+static void call_display_list_array(const region_mesh_t* mesh, const region_display_list_array_t* display_list_array) {
+	for (size_t i = 0; i < display_list_array->num_display_lists; i++) {
+		const display_list_t* display_list = &display_list_array->display_lists[i];
+		if (mesh->vertex_format == region_vertex_format_tex_gen) {
+			set_region_tex_gen(display_list->tex_gen_tile, display_list->tex_gen_face);
+		}
+
+		GX_CallDispList((void*) display_list->data, display_list->num_bytes);
+	}
+}
+
+// A face can only be seen from in front of its plane, and the planes of a region's faces facing in a direction are at most the region's size - 1 voxels apart.
+// So a bucket is skipped if the camera is behind the furthest plane its faces can be on.
+static bool is_solid_face_bucket_visible(voxel_face_t face, s32vec3s region_pos) {
+	f32 begin_x = (f32) (region_pos.x * REGION_SIZE_X);
+	f32 begin_y = (f32) (region_pos.y * REGION_SIZE_Y);
+	f32 begin_z = (f32) (region_pos.z * REGION_SIZE_Z);
+	switch (face) {
+		default:
+		case voxel_face_front: return cam_position.x > begin_x + 1.0f;
+		case voxel_face_back: return cam_position.x < begin_x + (f32) (REGION_SIZE_X - 1);
+		case voxel_face_top: return cam_position.y > begin_y + 1.0f;
+		case voxel_face_bottom: return cam_position.y < begin_y + (f32) (REGION_SIZE_Y - 1);
+		case voxel_face_right: return cam_position.z > begin_z + 1.0f;
+		case voxel_face_left: return cam_position.z < begin_z + (f32) (REGION_SIZE_Z - 1);
+	}
+}
+
+static void call_solid_display_lists(void) {
+	for (size_t i = 0; i < num_visible_regions; i++) {
+		const visible_region_t* visible_region = &visible_regions[i];
+		s32vec3s region_pos = visible_region->region_pos;
+
+		bool loaded_region = false;
+		for (u8 face = 0; face < 6; face++) {
+			const region_display_list_array_t* display_list_array = &visible_region->mesh->display_list_arrays[REGION_SOLID_DISPLAY_LIST_ARRAYS_INDEX + face];
+			if (display_list_array->num_display_lists == 0 || !is_solid_face_bucket_visible((voxel_face_t) face, region_pos)) {
+				continue;
+			}
+
+			if (!loaded_region) {
+				load_visible_region(visible_region);
+				loaded_region = true;
+			}
+			call_display_list_array(visible_region->mesh, display_list_array);
+		}
+	}
+}
+
+// Blended passes should be drawn back to front, other passes front to back so that early z rejects as much as possible
+static void call_display_lists(size_t display_list_array_index, bool back_to_front) {
+	for (size_t i = 0; i < num_visible_regions; i++) {
+		const visible_region_t* visible_region = &visible_regions[back_to_front ? num_visible_regions - 1 - i : i];
+		const region_display_list_array_t* display_list_array = &visible_region->mesh->display_list_arrays[display_list_array_index];
+		if (display_list_array->num_display_lists == 0) {
+			continue;
+		}
+
+		load_visible_region(visible_region);
+		call_display_list_array(visible_region->mesh, display_list_array);
+	}
 }
 
 void init_region_rendering(void) {
-	GX_SetVtxAttrFmt(REGION_VERTEX_FORMAT_INDEX, GX_VA_POS, GX_POS_XYZ, GX_U8, 2);
-	GX_SetVtxAttrFmt(REGION_VERTEX_FORMAT_INDEX, GX_VA_TEX0, GX_TEX_ST, GX_U8, 4);
+	visible_regions = malloc(get_num_regions() * sizeof(*visible_regions));
+	region_walk_queue = malloc(get_num_regions() * sizeof(*region_walk_queue));
+	walked_regions = malloc(get_num_regions() * sizeof(*walked_regions));
+	sorted_region_slot_indices = malloc(get_num_regions() * sizeof(*sorted_region_slot_indices));
+	region_distances = malloc(get_num_regions() * sizeof(*region_distances));
+	for (size_t i = 0; i < get_num_regions(); i++) {
+		sorted_region_slot_indices[i] = i;
+	}
+
+	u32 window_width = world_size.x * REGION_SIZE_X;
+	if (world_size.y * REGION_SIZE_Y < window_width) {
+		window_width = world_size.y * REGION_SIZE_Y;
+	}
+	if (world_size.z * REGION_SIZE_Z < window_width) {
+		window_width = world_size.z * REGION_SIZE_Z;
+	}
+	region_lod_distance = (f32) window_width / 2.0f;
+
+	GX_SetVtxAttrFmt(REGION_VERTEX_FORMAT_INDEX, GX_VA_POS, GX_POS_XYZ, GX_U8, REGION_POSITION_FRAC_BITS);
+	GX_SetVtxAttrFmt(REGION_VERTEX_FORMAT_INDEX, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+	GX_SetVtxAttrFmt(REGION_VERTEX_FORMAT_INDEX, GX_VA_CLR1, GX_CLR_RGBA, GX_RGBA8, 0);
+	GX_SetVtxAttrFmt(REGION_VERTEX_FORMAT_INDEX, GX_VA_TEX0, GX_TEX_ST, GX_U8, 0);
+	GX_SetVtxAttrFmt(REGION_TEX_GEN_VERTEX_FORMAT_INDEX, GX_VA_POS, GX_POS_XYZ, GX_U8, REGION_POSITION_FRAC_BITS);
+	GX_SetVtxAttrFmt(REGION_TEX_GEN_VERTEX_FORMAT_INDEX, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+	GX_SetVtxAttrFmt(REGION_TEX_GEN_VERTEX_FORMAT_INDEX, GX_VA_CLR1, GX_CLR_RGBA, GX_RGBA8, 0);
+
+	for (u32 ao = 0; ao < NUM_REGION_AO_LEVELS; ao++) {
+		for (u32 light = 0; light < NUM_LIGHT_LEVELS; light++) {
+			f32 brightness = region_ao_brightnesses[ao] * powf(LIGHT_LEVEL_FALLOFF, (f32) (MAX_LIGHT_LEVEL - light));
+			u8 value = (u8) ((brightness * 255.0f) + 0.5f);
+			region_shade_colors[(ao * NUM_LIGHT_LEVELS) + light] = (GXColor) { value, value, value, 0xff };
+		}
+	}
+	DCFlushRange(region_shade_colors, sizeof(region_shade_colors));
+
+	for (u8 face = 0; face <= CROSS_TEX_GEN_FACE; face++) {
+		GX_LoadTexMtxImm((f32 (*)[4]) tex_gen_matrices[face], get_tex_gen_matrix_index(face), GX_MTX2x4);
+	}
+	GX_LoadTexMtxImm((f32 (*)[4]) region_atlas_tex_matrix, REGION_ATLAS_TEX_MATRIX_INDEX, GX_MTX2x4);
 }
 
 void draw_regions(const mat4s* view) {
-	GX_SetNumTevStages(2);
-	GX_SetNumChans(1);
+	GX_SetNumTevStages(4);
+	GX_SetNumChans(2);
 	GX_SetNumTexGens(1);
 
-	GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
+	GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, REGION_ATLAS_TEX_MATRIX_INDEX);
+	load_region_texture();
+	tex_gen_tile = NO_TEX_GEN;
+	tex_gen_face = NO_TEX_GEN;
 
-	GX_SetTevOp(GX_TEVSTAGE0,GX_REPLACE);
-	GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
+	// The vertex colors are the shade colors baked into the vertices, the sky shade in color 0 and the block shade in color 1.
+	// The sky shade is tinted with the sky light color and the brighter of it and the block shade is kept, then the texture is multiplied by it.
+	// Both shades have the vertex's ambient occlusion baked in, so keeping one of them applies it once instead of adding it up.
+	GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR0A0);
+	GX_SetTevColorIn(GX_TEVSTAGE0, GX_CC_ZERO, GX_CC_RASC, GX_CC_C2, GX_CC_ZERO);
+	GX_SetTevColorOp(GX_TEVSTAGE0, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+	GX_SetTevAlphaIn(GX_TEVSTAGE0, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_RASA);
+	GX_SetTevAlphaOp(GX_TEVSTAGE0, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
 
-	GX_SetTevOrder(GX_TEVSTAGE1, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR0A0);
-	GX_SetTevOp(GX_TEVSTAGE1, GX_PASSCLR);
-	GX_SetTevAlphaIn(GX_TEVSTAGE1, GX_CA_ZERO, GX_CA_APREV, GX_CA_A1, GX_CA_ZERO);
+	// Register 0 gets the tinted sky shade where it is brighter than the block shade and 0 elsewhere
+	GX_SetTevOrder(GX_TEVSTAGE1, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR1A1);
+	GX_SetTevColorIn(GX_TEVSTAGE1, GX_CC_CPREV, GX_CC_RASC, GX_CC_CPREV, GX_CC_ZERO);
+	GX_SetTevColorOp(GX_TEVSTAGE1, GX_TEV_COMP_RGB8_GT, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVREG0);
+	GX_SetTevAlphaIn(GX_TEVSTAGE1, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_APREV);
 	GX_SetTevAlphaOp(GX_TEVSTAGE1, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
 
+	// The block shade is added onto register 0 where it is brighter than it, which leaves the brighter of the two shades
+	GX_SetTevOrder(GX_TEVSTAGE2, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR1A1);
+	GX_SetTevColorIn(GX_TEVSTAGE2, GX_CC_RASC, GX_CC_C0, GX_CC_RASC, GX_CC_C0);
+	GX_SetTevColorOp(GX_TEVSTAGE2, GX_TEV_COMP_RGB8_GT, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+	GX_SetTevAlphaIn(GX_TEVSTAGE2, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_APREV);
+	GX_SetTevAlphaOp(GX_TEVSTAGE2, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+
+	GX_SetTevOrder(GX_TEVSTAGE3, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
+	GX_SetTevColorIn(GX_TEVSTAGE3, GX_CC_ZERO, GX_CC_TEXC, GX_CC_CPREV, GX_CC_ZERO);
+	GX_SetTevColorOp(GX_TEVSTAGE3, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+	GX_SetTevAlphaIn(GX_TEVSTAGE3, GX_CA_ZERO, GX_CA_TEXA, GX_CA_A1, GX_CA_ZERO);
+	GX_SetTevAlphaOp(GX_TEVSTAGE3, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+
 	//
 
 	GX_ClearVtxDesc();
-	GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
-	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+	position_vtx_desc = GX_NONE;
+	tex_coord_vtx_desc = GX_NONE;
+	set_region_vtx_desc(GX_DIRECT, GX_DIRECT);
+	// Every vertex format has its shades as indices into the shade colors
+	GX_SetVtxDesc(GX_VA_CLR0, GX_INDEX8);
+	GX_SetVtxDesc(GX_VA_CLR1, GX_INDEX8);
+	GX_SetArray(GX_VA_CLR0, region_shade_colors, sizeof(*region_shade_colors));
+	GX_SetArray(GX_VA_CLR1, region_shade_colors, sizeof(*region_shade_colors));
+
+	// Freed vertex arrays may have been reused for other regions since the last frame
+	GX_InvVtxCache();
 
 	GX_SetTevColor(GX_TEVREG1, (GXColor){ 0xff, 0xff, 0xff, 0xff }); // Set alpha
+	GX_SetTevColor(GX_TEVREG2, region_sky_light_color);
+
+	update_visible_regions(view);
 
-	call_display_lists(view, 0);
-	call_display_lists(view, 1);
+	call_solid_display_lists();
+	call_display_lists(REGION_TRANSPARENT_DISPLAY_LIST_ARRAY_INDEX, true);
 	GX_SetAlphaCompare(GX_GEQUAL, 1, GX_AOP_AND, GX_ALWAYS, 0);
 	GX_SetZCompLoc(GX_FALSE);
 	GX_SetCullMode(GX_CULL_NONE);
-	call_display_lists(view, 2);
+	call_display_lists(REGION_CROSS_DISPLAY_LIST_ARRAY_INDEX, false);
 	GX_SetAlphaCompare(GX_ALWAYS, 0, GX_AOP_AND, GX_ALWAYS, 0);
 	GX_SetZCompLoc(GX_TRUE);
 	GX_SetCullMode(GX_CULL_BACK);
@@ -1,8 +1,28 @@
 #pragma once
+#include "game/region.h"
 #include <cglm/struct/mat4.h>
+#include <ogc/gx.h>
 
 #define REGION_MATRIX_INDEX GX_PNMTX5
 #define REGION_VERTEX_FORMAT_INDEX GX_VTXFMT5
+// Positions and shades only, for region_vertex_format_tex_gen
+#define REGION_TEX_GEN_VERTEX_FORMAT_INDEX GX_VTXFMT6
 
+// Results of frustum culling in the last draw_regions call, regions without any display lists aren't counted
+extern u32 num_drawn_regions;
+extern u32 num_culled_regions;
+// Whether draw_regions updates num_culled_regions and num_bytes_per_region, which walks every mesh of every region so it is only done while they are shown
+extern bool region_stats_enabled;
+// Average bytes of display lists and vertex arrays of the regions with display lists, indexed by the region_vertex_format_t they were meshed with
+extern u32 num_bytes_per_region[NUM_REGION_VERTEX_FORMATS];
+// Regions drawn in the last draw_regions call with each level of detail
+extern u32 num_drawn_regions_per_lod[NUM_REGION_LODS];
+
+// Whether far regions are drawn with their downsampled meshes, regions are always drawn at full detail otherwise
+extern bool region_lods_enabled;
+// Multiplied onto the sky light of every region when it is drawn, so the sky can be dimmed or tinted, e.g. for the time of day, without meshing the regions again
+extern GXColor region_sky_light_color;
+
+// Must be called after init_region_management
 void init_region_rendering(void);
 void draw_regions(const mat4s* view);
\ No newline at end of file
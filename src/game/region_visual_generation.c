@@ -1,13 +1,16 @@
 #include "region_visual_generation.h"
+#include "asset.h"
 #include "chunk.h"
 #include "game/display_list.h"
+#include "game/display_list_pool.h"
 #include "game/region.h"
+#include "game/region_mesh_cache.h"
 #include "game/region_rendering.h"
 #include "log.h"
 #include "voxel.h"
+#include "voxel_type_info.h"
 #include "gfx/instruction_size.h"
 #include "util.h"
-#include <malloc.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ogc/cache.h>
@@ -15,353 +18,1220 @@
 
 // Possible future optimization is to stop generating the mesh after we reach the end of voxels to generate meshes from
 
+region_mesher_t region_mesher = region_mesher_greedy;
+region_vertex_format_t region_vertex_format = region_vertex_format_direct;
+
 typedef struct {
-    u8 type;
+    voxel_type_t type;
+    voxel_face_t face;
     u8 x;
     u8 y;
     u8 z;
+    // Number of cells the face is merged across along the run and row axes of get_greedy_face_position
+    u8 length;
+    u8 width;
+    // Ambient occlusion of each vertex in template order, 2 bits each starting from the lowest bits
+    u8 ao;
+    // Light of the voxel in front of the face, or of the cross itself
+    voxel_light_t light;
 } voxel_mesh_t;
 
-static_assert(sizeof(voxel_mesh_t) == 4, "");
+// Vertices are written in the order of the direct format's attributes: position, sky shade, block shade, then texture coordinate
+#define REGION_VERTEX_SIZE 7
+#define VERTEX_SKY_SHADE_OFFSET 3
+#define VERTEX_BLOCK_SHADE_OFFSET 4
+#define VERTEX_S_OFFSET 5
+#define VERTEX_T_OFFSET 6
+#define MIN_REGION_VERTEX_BUFFER_BYTES 4096
 
-#define NUM_SOLID_BUILDING_MESHES 204
-#define NUM_TRANSPARENT_BUILDING_MESHES 204
-#define NUM_TRANSPARENT_DOUBLE_SIDED_BUILDING_MESHES 102
+// The begin instruction's vertex count is a u16, so a pass with more quads than that is split across several display lists.
+// A 16x16x16 region has at most 3 * NUM_REGION_VOXELS visible transparent faces (water checkerboarded with air), so every pass fits in one.
+#define MAX_DISPLAY_LIST_QUADS (0xffff / 4)
 
-typedef struct {
-    alignas(32) voxel_mesh_t solid[NUM_SOLID_BUILDING_MESHES];
-    alignas(32) voxel_mesh_t transparent[NUM_TRANSPARENT_BUILDING_MESHES];
-    alignas(32) voxel_mesh_t transparent_double_sided[NUM_TRANSPARENT_DOUBLE_SIDED_BUILDING_MESHES];
-} building_meshes_arrays_t;
+static void reset_region_vertex_buffers(region_mesh_buffers_t* mesh_buffers) {
+    for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+        // Room is left for the begin instruction, which needs the final vertex count
+        mesh_buffers->vertex_buffers[i].num_bytes = BEGIN_INSTRUCTION_SIZE;
+    }
+}
 
-static_assert(sizeof(building_meshes_arrays_t) <= 4096*3, "");
+// Returns where the reserved vertices should be written, the buffer keeps its memory between regions so it rarely grows
+static u8* reserve_region_vertices(region_vertex_buffer_t* buffer, size_t num_verts) {
+    size_t num_bytes = buffer->num_bytes + (num_verts * REGION_VERTEX_SIZE);
+    if (num_bytes > buffer->num_allocated_bytes) {
+        size_t num_allocated_bytes = buffer->num_allocated_bytes == 0 ? MIN_REGION_VERTEX_BUFFER_BYTES : buffer->num_allocated_bytes;
+        while (num_allocated_bytes < num_bytes) {
+            num_allocated_bytes *= 2;
+        }
+        buffer->data = realloc(buffer->data, num_allocated_bytes);
+        buffer->num_allocated_bytes = num_allocated_bytes;
+    }
 
-static building_meshes_arrays_t building_meshes_arrays;
+    u8* data = buffer->data + buffer->num_bytes;
+    buffer->num_bytes = num_bytes;
+    return data;
+}
 
-typedef struct {
-    size_t solid;
-    size_t transparent;
-    size_t transparent_double_sided;
-} meshes_indices_t;
-
-typedef enum __attribute__((__packed__)) {
-    voxel_mesh_category_invisible,
-    voxel_mesh_category_cube,
-    voxel_mesh_category_transparent_cube,
-    voxel_mesh_category_cross
-} voxel_mesh_category_t;
-
-static_assert(sizeof(voxel_mesh_category_t) == 1);
-
-static voxel_mesh_category_t get_voxel_mesh_category(voxel_type_t type) {
-    switch (type) {
+// A quad's vertices are its template stretched to the quad's size and added onto the position and texture tile of its voxel, repeated for each vertex.
+// Positions are in REGION_POSITION_SCALE steps per voxel, texture s coordinates in tiles of the texture atlas and t coordinates in repeats of the texture.
+// The shades of every vertex are filled in when the quad is written.
+#define QUAD_TEMPLATE_SIZE (REGION_VERTEX_SIZE * 4)
+#define TEMPLATE_VERTEX(x, y, z, s, t) (u8) ((x) * REGION_POSITION_SCALE), (u8) ((y) * REGION_POSITION_SCALE), (u8) ((z) * REGION_POSITION_SCALE), 0, 0, (u8) (s), (u8) (t)
+
+// Indexed by voxel_face_t. The t texture coordinate runs along the run axis of get_greedy_face_position, which is the one merged faces can repeat their texture on with every vertex format.
+alignas(32) static const u8 face_quad_templates[6][QUAD_TEMPLATE_SIZE] = {
+    [voxel_face_front] = { TEMPLATE_VERTEX(1, 1, 0, 0, 0), TEMPLATE_VERTEX(1, 0, 0, 0, 1), TEMPLATE_VERTEX(1, 0, 1, 1, 1), TEMPLATE_VERTEX(1, 1, 1, 1, 0) },
+    [voxel_face_back] = { TEMPLATE_VERTEX(0, 1, 0, 0, 0), TEMPLATE_VERTEX(0, 1, 1, 1, 0), TEMPLATE_VERTEX(0, 0, 1, 1, 1), TEMPLATE_VERTEX(0, 0, 0, 0, 1) },
+    [voxel_face_top] = { TEMPLATE_VERTEX(0, 1, 1, 0, 0), TEMPLATE_VERTEX(0, 1, 0, 1, 0), TEMPLATE_VERTEX(1, 1, 0, 1, 1), TEMPLATE_VERTEX(1, 1, 1, 0, 1) },
+    [voxel_face_bottom] = { TEMPLATE_VERTEX(0, 0, 1, 0, 0), TEMPLATE_VERTEX(1, 0, 1, 1, 0), TEMPLATE_VERTEX(1, 0, 0, 1, 1), TEMPLATE_VERTEX(0, 0, 0, 0, 1) },
+    [voxel_face_right] = { TEMPLATE_VERTEX(1, 0, 1, 0, 1), TEMPLATE_VERTEX(0, 0, 1, 1, 1), TEMPLATE_VERTEX(0, 1, 1, 1, 0), TEMPLATE_VERTEX(1, 1, 1, 0, 0) },
+    [voxel_face_left] = { TEMPLATE_VERTEX(1, 0, 0, 0, 1), TEMPLATE_VERTEX(1, 1, 0, 0, 0), TEMPLATE_VERTEX(0, 1, 0, 1, 0), TEMPLATE_VERTEX(0, 0, 0, 1, 1) }
+};
+
+// The two diagonal quads of a cross
+alignas(32) static const u8 cross_quad_templates[2][QUAD_TEMPLATE_SIZE] = {
+    { TEMPLATE_VERTEX(0, 0, 0, 0, 1), TEMPLATE_VERTEX(1, 0, 1, 1, 1), TEMPLATE_VERTEX(1, 1, 1, 1, 0), TEMPLATE_VERTEX(0, 1, 0, 0, 0) },
+    { TEMPLATE_VERTEX(1, 0, 0, 0, 1), TEMPLATE_VERTEX(0, 0, 1, 1, 1), TEMPLATE_VERTEX(0, 1, 1, 1, 0), TEMPLATE_VERTEX(1, 1, 0, 0, 0) }
+};
+
+#define MAX_VERTEX_AO (NUM_REGION_AO_LEVELS - 1)
+#define UNOCCLUDED_QUAD_AO 0xff
+
+static u8 get_quad_vertex_ao(u8 ao, size_t vertex) {
+    return (ao >> (vertex * 2)) & MAX_VERTEX_AO;
+}
+
+// Template positions are stretched by the quad's extent along each axis in cells, then shifted up by the level of detail since each of its cells is 1 << lod voxels wide.
+// Template t coordinates are stretched by the quad's length, so that the texture repeats once per cell along it.
+// GX splits quads along the diagonal from their first vertex, so the vertices are rotated by one when the other diagonal is brighter.
+// That keeps the darkness of a single occluded vertex in its own triangle instead of spreading it across the whole quad.
+// Every vertex of the quad has the same light, which is combined with each vertex's ambient occlusion into its shades.
+static void write_quad_vertices(u8* data, const u8 template[QUAD_TEMPLATE_SIZE], u8 x, u8 y, u8 z, u8 tx, u8 lod, u32vec3s extents, u8 length, u8 ao, voxel_light_t light) {
+    size_t first_vertex = get_quad_vertex_ao(ao, 0) + get_quad_vertex_ao(ao, 2) < get_quad_vertex_ao(ao, 1) + get_quad_vertex_ao(ao, 3) ? 1 : 0;
+    for (size_t i = 0; i < 4; i++) {
+        size_t vertex = (first_vertex + i) % 4;
+        const u8* template_vertex = &template[vertex * REGION_VERTEX_SIZE];
+        u8* vertex_data = &data[i * REGION_VERTEX_SIZE];
+        vertex_data[0] = (u8) ((template_vertex[0] * extents.x) << lod) + x;
+        vertex_data[1] = (u8) ((template_vertex[1] * extents.y) << lod) + y;
+        vertex_data[2] = (u8) ((template_vertex[2] * extents.z) << lod) + z;
+        u8 vertex_ao = get_quad_vertex_ao(ao, vertex);
+        vertex_data[VERTEX_SKY_SHADE_OFFSET] = (u8) ((vertex_ao * NUM_LIGHT_LEVELS) + get_sky_light(light));
+        vertex_data[VERTEX_BLOCK_SHADE_OFFSET] = (u8) ((vertex_ao * NUM_LIGHT_LEVELS) + get_block_light(light));
+        vertex_data[VERTEX_S_OFFSET] = template_vertex[VERTEX_S_OFFSET] + tx;
+        vertex_data[VERTEX_T_OFFSET] = (u8) (template_vertex[VERTEX_T_OFFSET] * length);
+    }
+}
+
+// Texture coordinates aren't needed for region_vertex_format_tex_gen, so the s and t of a quad's first vertex hold the tile and face that the quad is grouped by instead
+#define TEX_GEN_TILE_OFFSET VERTEX_S_OFFSET
+#define TEX_GEN_FACE_OFFSET VERTEX_T_OFFSET
+
+// Maps a position in a face layer to a voxel local position.
+// layer is along the face normal, run is along the axis of the face's t texture coordinate and row along the one of its s texture coordinate (see face_quad_templates).
+static u32vec3s get_greedy_face_position(voxel_face_t face, u32 layer, u32 row, u32 run) {
+    switch (face) {
         default:
-            return voxel_mesh_category_invisible;
-        case voxel_type_debug:
-        case voxel_type_grass:
-        case voxel_type_stone:
-        case voxel_type_dirt:
-        case voxel_type_sand:
-        case voxel_type_wood_planks:
-        case voxel_type_stone_slab_both:
-            return voxel_mesh_category_cube;
-        case voxel_type_water:
-            return voxel_mesh_category_transparent_cube;
-        case voxel_type_tall_grass:
-            return voxel_mesh_category_cross;
-    }
-}
-
-static u8 get_face_tex(voxel_type_t type, voxel_face_t face) {
-    switch (type) {
-        default: break;
-        case voxel_type_debug: return 0;
-        case voxel_type_grass: switch (face) {
-            default: return 4;
-            case voxel_face_top: return 0;
-            case voxel_face_bottom: return 2;
-        }
-        case voxel_type_stone: return 1;
-        case voxel_type_dirt: return 2;
-        case voxel_type_sand: return 6;
-        case voxel_type_wood_planks: return 10;
-        case voxel_type_stone_slab_both: switch (face) {
-            default: return 8;
-            case voxel_face_top: return 9;
+        case voxel_face_front:
+        case voxel_face_back:
+            return (u32vec3s) {{ layer, run, row }};
+        case voxel_face_right:
+        case voxel_face_left:
+            return (u32vec3s) {{ row, run, layer }};
+        case voxel_face_top:
+            return (u32vec3s) {{ run, layer, row }};
+        case voxel_face_bottom:
+            return (u32vec3s) {{ row, layer, run }};
+    }
+}
+
+// The mesh's position, length and width are in cells of the level of detail
+static void write_face_mesh(region_vertex_buffer_t* buffer, voxel_mesh_t mesh, region_vertex_format_t vertex_format, u8 lod) {
+    u8* data = reserve_region_vertices(buffer, 4);
+    u8 tx = voxel_type_infos[mesh.type].face_texs[mesh.face];
+    u8 scale = (u8) (REGION_POSITION_SCALE << lod);
+    u32vec3s extents = get_greedy_face_position(mesh.face, 1, mesh.width, mesh.length);
+    write_quad_vertices(data, face_quad_templates[mesh.face], mesh.x * scale, mesh.y * scale, mesh.z * scale, tx, lod, extents, mesh.length, mesh.ao, mesh.light);
+    if (vertex_format == region_vertex_format_tex_gen) {
+        data[TEX_GEN_TILE_OFFSET] = tx;
+        data[TEX_GEN_FACE_OFFSET] = mesh.face;
+    }
+}
+
+static void write_cross_mesh(region_vertex_buffer_t* buffer, voxel_mesh_t mesh, region_vertex_format_t vertex_format) {
+    u8* data = reserve_region_vertices(buffer, 8);
+    u8 tx = voxel_type_infos[mesh.type].face_texs[voxel_face_front];
+    u32vec3s extents = {{ 1, 1, 1 }};
+    write_quad_vertices(data, cross_quad_templates[0], mesh.x * REGION_POSITION_SCALE, mesh.y * REGION_POSITION_SCALE, mesh.z * REGION_POSITION_SCALE, tx, 0, extents, 1, UNOCCLUDED_QUAD_AO, mesh.light);
+    write_quad_vertices(data + QUAD_TEMPLATE_SIZE, cross_quad_templates[1], mesh.x * REGION_POSITION_SCALE, mesh.y * REGION_POSITION_SCALE, mesh.z * REGION_POSITION_SCALE, tx, 0, extents, 1, UNOCCLUDED_QUAD_AO, mesh.light);
+    if (vertex_format == region_vertex_format_tex_gen) {
+        data[TEX_GEN_TILE_OFFSET] = tx;
+        data[TEX_GEN_FACE_OFFSET] = CROSS_TEX_GEN_FACE;
+        data[QUAD_TEMPLATE_SIZE + TEX_GEN_TILE_OFFSET] = tx;
+        data[QUAD_TEMPLATE_SIZE + TEX_GEN_FACE_OFFSET] = CROSS_TEX_GEN_FACE;
+    }
+}
+
+// GX skips vertices whose position index has every bit set, so that index is never handed out
+#define MAX_INDEX8_ARRAY_SIZE 0xff
+
+static_assert(NUM_REGION_VERTEX_POSITIONS < 0xffff, "Region vertex positions don't fit in GX_INDEX16");
+
+static u16 get_position_index(region_mesh_buffers_t* mesh_buffers, const u8* vertex) {
+    u16* index = &mesh_buffers->position_indices[vertex[0] / REGION_POSITION_SCALE][vertex[1] / REGION_POSITION_SCALE][vertex[2] / REGION_POSITION_SCALE];
+    if (*index == 0) {
+        memcpy(mesh_buffers->positions[mesh_buffers->num_positions], vertex, 3);
+        *index = ++mesh_buffers->num_positions;
+    }
+    return *index - 1;
+}
+
+static u16 get_tex_coord_index(region_mesh_buffers_t* mesh_buffers, const u8* vertex) {
+    u16* index = &mesh_buffers->tex_coord_indices[vertex[VERTEX_S_OFFSET]][vertex[VERTEX_T_OFFSET]];
+    if (*index == 0) {
+        memcpy(mesh_buffers->tex_coords[mesh_buffers->num_tex_coords], vertex + VERTEX_S_OFFSET, 2);
+        *index = ++mesh_buffers->num_tex_coords;
+    }
+    return *index - 1;
+}
+
+static void clear_vertex_indices(region_mesh_buffers_t* mesh_buffers) {
+    for (size_t i = 0; i < mesh_buffers->num_positions; i++) {
+        const u8* position = mesh_buffers->positions[i];
+        mesh_buffers->position_indices[position[0] / REGION_POSITION_SCALE][position[1] / REGION_POSITION_SCALE][position[2] / REGION_POSITION_SCALE] = 0;
+    }
+    for (size_t i = 0; i < mesh_buffers->num_tex_coords; i++) {
+        const u8* tex_coord = mesh_buffers->tex_coords[i];
+        mesh_buffers->tex_coord_indices[tex_coord[0]][tex_coord[1]] = 0;
+    }
+    mesh_buffers->num_positions = 0;
+    mesh_buffers->num_tex_coords = 0;
+}
+
+static u8 get_index_type(u16 num_entries) {
+    return num_entries <= MAX_INDEX8_ARRAY_SIZE ? GX_INDEX8 : GX_INDEX16;
+}
+
+static size_t get_index_size(u8 index_type) {
+    return index_type == GX_INDEX8 ? 1 : 2;
+}
+
+static u8* write_index(u8* data, u8 index_type, u16 index) {
+    if (index_type == GX_INDEX16) {
+        *data++ = (u8) (index >> 8);
+    }
+    *data++ = (u8) index;
+    return data;
+}
+
+// Adds every vertex of the region to the unique positions and texture coordinates, then copies those into the region's vertex arrays
+static void write_vertex_arrays(region_mesh_buffers_t* mesh_buffers, region_vertex_arrays_t* vertex_arrays) {
+    for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+        const region_vertex_buffer_t* buffer = &mesh_buffers->vertex_buffers[i];
+        for (size_t j = BEGIN_INSTRUCTION_SIZE; j < buffer->num_bytes; j += REGION_VERTEX_SIZE) {
+            get_position_index(mesh_buffers, &buffer->data[j]);
+            get_tex_coord_index(mesh_buffers, &buffer->data[j]);
         }
-        case voxel_type_water: return 7;
-    }
-    return 0;
-}
-
-static u8 get_tex(voxel_type_t) {
-    return 5;
-}
-
-static void write_meshes_into_display_list(size_t display_list_array_index, size_t num_meshes, size_t num_verts, const voxel_mesh_t meshes[], region_render_info_t* render_info) {
-    u16 num_display_list_bytes = (u16) align_to_32(
-        BEGIN_INSTRUCTION_SIZE +
-        GET_VECTOR_INSTRUCTION_SIZE(3, sizeof(u8), num_verts) + 
-        GET_VECTOR_INSTRUCTION_SIZE(2, sizeof(u8), num_verts)
-    );
-    void* display_list_data = memalign(32, NUM_CHUNK_BYTES);
-
-    memset(display_list_data, 0, num_display_list_bytes);
-    DCInvalidateRange(display_list_data, num_display_list_bytes);
-
-    GX_BeginDispList(display_list_data, num_display_list_bytes);
-    GX_Begin(GX_QUADS, REGION_VERTEX_FORMAT_INDEX, (u16) num_verts);
-
-    switch (display_list_array_index) {
-        case 0:
-        case 1:
-            for (size_t i = 0; i < num_meshes; i++) {
-                voxel_mesh_t mesh = meshes[i];
-
-                voxel_type_t voxel_type = (voxel_type_t) (mesh.type / 8);
-                voxel_face_t voxel_face = (voxel_face_t) (mesh.type % 8);
-                u8 px = mesh.x * 4;
-                u8 py = mesh.y * 4;
-                u8 pz = mesh.z * 4;
-                u8 pox = px + 4;
-                u8 poy = py + 4;
-                u8 poz = pz + 4;
-                u8 tx = get_face_tex(voxel_type, voxel_face);
-                u8 tox = tx + 1;
-                u8 ty = 0;
-                u8 toy = 16;
-
-                switch (voxel_face) {
-                    case voxel_face_front:
-                        GX_Position3u8(pox, poy, pz);
-                        GX_TexCoord2u8(tx, ty);
-                        GX_Position3u8(pox, py, pz);
-                        GX_TexCoord2u8(tx, toy);
-                        GX_Position3u8(pox, py,poz);
-                        GX_TexCoord2u8(tox, toy);
-                        GX_Position3u8(pox, poy,poz);
-                        GX_TexCoord2u8(tox, ty);
-                        break;
-                    case voxel_face_back:
-                        GX_Position3u8(px, poy, pz);
-                        GX_TexCoord2u8(tx, ty);	// Top Left of the quad (top)
-                        GX_Position3u8(px, poy, poz);
-                        GX_TexCoord2u8(tox, ty);	// Top Right of the quad (top)
-                        GX_Position3u8(px, py, poz);
-                        GX_TexCoord2u8(tox, toy);	// Bottom Right of the quad (top)
-                        GX_Position3u8(px, py, pz);
-                        GX_TexCoord2u8(tx, toy);		// Bottom Left of the quad (top)
-                        break;
-                    case voxel_face_top:
-                        GX_Position3u8(px, poy, poz);
-                        GX_TexCoord2u8(tx, ty);	// Bottom Left Of The Quad (Back)
-                        GX_Position3u8(px, poy, pz);
-                        GX_TexCoord2u8(tox, ty);	// Bottom Right Of The Quad (Back)
-                        GX_Position3u8(pox, poy, pz); 
-                        GX_TexCoord2u8(tox, toy);	// Top Right Of The Quad (Back)
-                        GX_Position3u8(pox, poy, poz);
-                        GX_TexCoord2u8(tx, toy);	// Top Left Of The Quad (Back)
-                        break;
-                    case voxel_face_bottom:
-                        GX_Position3u8(px, py, poz);
-                        GX_TexCoord2u8(tx, ty);		// Top Right Of The Quad (Front)
-                        GX_Position3u8(pox, py, poz);
-                        GX_TexCoord2u8(tox, ty);	// Top Left Of The Quad (Front)
-                        GX_Position3u8(pox, py, pz);
-                        GX_TexCoord2u8(tox, toy);	// Bottom Left Of The Quad (Front)
-                        GX_Position3u8(px, py, pz); 
-                        GX_TexCoord2u8(tx, toy);	// Bottom Right Of The Quad (Front)
-                        break;
-                    case voxel_face_right:
-                        GX_Position3u8(pox, py, poz);
-                        GX_TexCoord2u8(tx, toy);	// Top Right Of The Quad (Right)
-                        GX_Position3u8(px, py, poz);
-                        GX_TexCoord2u8(tox, toy);		// Top Left Of The Quad (Right)
-                        GX_Position3u8(px, poy, poz);
-                        GX_TexCoord2u8(tox, ty);	// Bottom Left Of The Quad (Right)
-                        GX_Position3u8(pox, poy, poz);
-                        GX_TexCoord2u8(tx, ty);	// Bottom Right Of The Quad (Right)
-                        break;
-                    case voxel_face_left:
-                        GX_Position3u8(pox, py, pz);
-                        GX_TexCoord2u8(tx, toy);	// Top Right Of The Quad (Left)
-                        GX_Position3u8(pox, poy, pz); 
-                        GX_TexCoord2u8(tx, ty);	// Top Left Of The Quad (Left)
-                        GX_Position3u8(px, poy, pz);
-                        GX_TexCoord2u8(tox, ty);	// Bottom Left Of The Quad (Left)
-                        GX_Position3u8(px, py, pz);
-                        GX_TexCoord2u8(tox, toy);	// Bottom Right Of The Quad (Left)
-                        break;
-                }
-            }
-            break;
-        case 2:
-            for (size_t i = 0; i < num_meshes; i++) {
-                voxel_mesh_t mesh = meshes[i];
-
-                u8 px = mesh.x * 4;
-                u8 py = mesh.y * 4;
-                u8 pz = mesh.z * 4;
-                u8 pox = px + 4;
-                u8 poy = py + 4;
-                u8 poz = pz + 4;
-                u8 tx = get_tex((voxel_type_t) mesh.type);
-                u8 tox = tx + 1;
-                u8 ty = 0;
-                u8 toy = 16;
-
-                GX_Position3u8(px, py, pz);
-                GX_TexCoord2u8(tx, toy);
-                GX_Position3u8(pox, py, poz);
-                GX_TexCoord2u8(tox, toy);
-                GX_Position3u8(pox, poy, poz);
-                GX_TexCoord2u8(tox, ty);
-                GX_Position3u8(px, poy, pz);
-                GX_TexCoord2u8(tx, ty);
-
-                GX_Position3u8(pox, py, pz);
-                GX_TexCoord2u8(tx, toy);
-                GX_Position3u8(px, py, poz);
-                GX_TexCoord2u8(tox, toy);
-                GX_Position3u8(px, poy, poz);
-                GX_TexCoord2u8(tox, ty);
-                GX_Position3u8(pox, poy, pz);
-                GX_TexCoord2u8(tx, ty);
-            }
-            break;
     }
-    
-    GX_End();
-    num_display_list_bytes = (u16) GX_EndDispList();
 
-    region_display_list_array_t* array = &render_info->display_list_arrays[display_list_array_index];
+    // Each array starts on a cache line
+    u32 tex_coords_offset = (u32) ((((mesh_buffers->num_positions * 3) + 31) / 32) * 32);
+    u32 num_bytes = (u32) ((((tex_coords_offset + (mesh_buffers->num_tex_coords * 2)) + 31) / 32) * 32);
+    u8* data = alloc_display_list(num_bytes);
+    memcpy(data, mesh_buffers->positions, mesh_buffers->num_positions * 3);
+    memcpy(data + tex_coords_offset, mesh_buffers->tex_coords, mesh_buffers->num_tex_coords * 2);
+
+    DCFlushRange(data, num_bytes);
+
+    *vertex_arrays = (region_vertex_arrays_t) {
+        .data = data,
+        .num_bytes = num_bytes,
+        .tex_coords_offset = tex_coords_offset,
+        .position_index_type = get_index_type(mesh_buffers->num_positions),
+        .tex_coord_index_type = get_index_type(mesh_buffers->num_tex_coords)
+    };
+}
+
+static void add_display_list(region_display_list_array_t* array, display_list_t display_list) {
     array->num_display_lists++;
     array->display_lists = realloc(array->display_lists, array->num_display_lists * sizeof(*array->display_lists));
+    array->display_lists[array->num_display_lists - 1] = display_list;
+}
+
+// Padded with GX_NOP (0) to a multiple of 32 bytes like GX_EndDispList does
+static u32 get_padded_display_list_num_bytes(size_t num_bytes) {
+    return (u32) (((num_bytes + 31) / 32) * 32);
+}
+
+static u8* write_begin_instruction(u8* data, u8 vertex_format_index, size_t num_verts) {
+    data[0] = GX_QUADS | vertex_format_index;
+    data[1] = (u8) (num_verts >> 8);
+    data[2] = (u8) num_verts;
+    return data + BEGIN_INSTRUCTION_SIZE;
+}
 
-    array->display_lists[array->num_display_lists - 1] = (display_list_t) {
+// Adds a display list sized to fit num_verts vertices exactly to the array, and returns where its vertices should be written
+static u8* add_region_display_list(region_display_list_array_t* array, u8 vertex_format_index, size_t num_verts, size_t vertex_size) {
+    size_t num_bytes = BEGIN_INSTRUCTION_SIZE + (num_verts * vertex_size);
+    u32 num_display_list_bytes = get_padded_display_list_num_bytes(num_bytes);
+    u8* display_list_data = alloc_display_list(num_display_list_bytes);
+    memset(display_list_data + num_bytes, 0, num_display_list_bytes - num_bytes);
+
+    add_display_list(array, (display_list_t) {
         .num_bytes = num_display_list_bytes,
         .data = display_list_data
-    };
+    });
+    return write_begin_instruction(display_list_data, vertex_format_index, num_verts);
 }
 
-typedef struct {
-    size_t solid;
-    size_t transparent;
-} face_meshes_indices_t;
+static void flush_display_lists(const region_display_list_array_t* array) {
+    for (size_t i = 0; i < array->num_display_lists; i++) {
+        DCFlushRange((void*) array->display_lists[i].data, array->display_lists[i].num_bytes);
+    }
+}
 
-static face_meshes_indices_t add_face_mesh_if_needed(
-    face_meshes_indices_t indices, const voxel_type_array_t* voxel_types, const voxel_type_array_t* neighbor_voxel_types, u32 x, u32 y, u32 z, voxel_type_t type, voxel_mesh_category_t category, voxel_face_t face, u32 nx, u32 ny, u32 nz
-) {
-    voxel_type_t neighbor_voxel_type;
-    if (nx >= (u32) REGION_SIZE || ny >= (u32) REGION_SIZE || nz >= (u32) REGION_SIZE) {
-        if (neighbor_voxel_types == NULL) {
-            return indices;
+static size_t get_display_list_num_quads(size_t num_quads, size_t first_quad) {
+    return num_quads - first_quad < MAX_DISPLAY_LIST_QUADS ? num_quads - first_quad : MAX_DISPLAY_LIST_QUADS;
+}
+
+#define NUM_TEX_GEN_FACES (CROSS_TEX_GEN_FACE + 1)
+#define NUM_TEX_GEN_GROUPS (NUM_TEX_GEN_FACES * NUM_REGION_TEXTURE_TILES)
+// The position and shades, which come first in every vertex
+#define REGION_TEX_GEN_VERTEX_SIZE 5
+
+// Every pass gets display lists of positions and shades for each face and tile its quads have, quads are moved into them with a counting sort
+static void write_tex_gen_display_lists(const region_mesh_buffers_t* mesh_buffers, region_mesh_t* mesh) {
+    for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+        const region_vertex_buffer_t* buffer = &mesh_buffers->vertex_buffers[i];
+        region_display_list_array_t* array = &mesh->display_list_arrays[i];
+
+        u32 num_group_quads[NUM_TEX_GEN_GROUPS] = { 0 };
+        for (size_t j = BEGIN_INSTRUCTION_SIZE; j < buffer->num_bytes; j += QUAD_TEMPLATE_SIZE) {
+            const u8* quad = &buffer->data[j];
+            num_group_quads[(quad[TEX_GEN_FACE_OFFSET] * NUM_REGION_TEXTURE_TILES) + quad[TEX_GEN_TILE_OFFSET]]++;
         }
-        neighbor_voxel_type = neighbor_voxel_types->types[nx % (u32) REGION_SIZE][ny % (u32) REGION_SIZE][nz % (u32) REGION_SIZE];
-    } else {
-        neighbor_voxel_type = voxel_types->types[nx][ny][nz];
+
+        // Index of the display list that each group's next MAX_DISPLAY_LIST_QUADS quads go into
+        size_t group_display_list_indices[NUM_TEX_GEN_GROUPS];
+        for (u8 group = 0; group < NUM_TEX_GEN_GROUPS; group++) {
+            group_display_list_indices[group] = array->num_display_lists;
+            for (size_t first_quad = 0; first_quad < num_group_quads[group]; first_quad += MAX_DISPLAY_LIST_QUADS) {
+                add_region_display_list(array, REGION_TEX_GEN_VERTEX_FORMAT_INDEX, get_display_list_num_quads(num_group_quads[group], first_quad) * 4, REGION_TEX_GEN_VERTEX_SIZE);
+
+                display_list_t* display_list = &array->display_lists[array->num_display_lists - 1];
+                display_list->tex_gen_tile = group % NUM_REGION_TEXTURE_TILES;
+                display_list->tex_gen_face = group / NUM_REGION_TEXTURE_TILES;
+            }
+        }
+
+        u32 num_written_group_quads[NUM_TEX_GEN_GROUPS] = { 0 };
+        u8* group_data[NUM_TEX_GEN_GROUPS];
+        for (size_t j = BEGIN_INSTRUCTION_SIZE; j < buffer->num_bytes; j += QUAD_TEMPLATE_SIZE) {
+            const u8* quad = &buffer->data[j];
+            size_t group = (size_t) ((quad[TEX_GEN_FACE_OFFSET] * NUM_REGION_TEXTURE_TILES) + quad[TEX_GEN_TILE_OFFSET]);
+            if (num_written_group_quads[group]++ % MAX_DISPLAY_LIST_QUADS == 0) {
+                group_data[group] = (u8*) array->display_lists[group_display_list_indices[group]++].data + BEGIN_INSTRUCTION_SIZE;
+            }
+
+            for (size_t k = 0; k < 4; k++) {
+                memcpy(group_data[group], &quad[k * REGION_VERTEX_SIZE], REGION_TEX_GEN_VERTEX_SIZE);
+                group_data[group] += REGION_TEX_GEN_VERTEX_SIZE;
+            }
+        }
+
+        flush_display_lists(array);
     }
-    voxel_mesh_category_t neighbor_mesh_category = get_voxel_mesh_category(neighbor_voxel_type);
+}
+
+// The display list bytes are written directly instead of through GX_BeginDispList.
+// GX_BeginDispList redirects the global GX FIFO, so it can't be used off the main thread (see region_worker.c).
+// Other than with region_vertex_format_tex_gen, each pass of a region gets a single display list unless it has more than MAX_DISPLAY_LIST_QUADS quads.
+static void write_vertex_buffers_into_display_lists(region_mesh_buffers_t* mesh_buffers, region_mesh_t* mesh) {
+    mesh->vertex_format = mesh_buffers->vertex_format;
+    if (mesh_buffers->vertex_format == region_vertex_format_tex_gen) {
+        write_tex_gen_display_lists(mesh_buffers, mesh);
+        return;
+    }
+
+    bool indexed = mesh_buffers->vertex_format == region_vertex_format_indexed;
+    const region_vertex_arrays_t* vertex_arrays = &mesh->vertex_arrays;
+    size_t vertex_size = REGION_VERTEX_SIZE;
+    if (indexed) {
+        write_vertex_arrays(mesh_buffers, &mesh->vertex_arrays);
+        // Shades are always GX_INDEX8 indices into the shade colors, between the position and texture coordinate indices
+        vertex_size = get_index_size(vertex_arrays->position_index_type) + 2 + get_index_size(vertex_arrays->tex_coord_index_type);
+    }
+
+    for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+        const region_vertex_buffer_t* buffer = &mesh_buffers->vertex_buffers[i];
+        region_display_list_array_t* array = &mesh->display_list_arrays[i];
+        size_t num_quads = (buffer->num_bytes - BEGIN_INSTRUCTION_SIZE) / QUAD_TEMPLATE_SIZE;
+
+        for (size_t first_quad = 0; first_quad < num_quads; first_quad += MAX_DISPLAY_LIST_QUADS) {
+            size_t num_verts = get_display_list_num_quads(num_quads, first_quad) * 4;
+            const u8* vertices = &buffer->data[BEGIN_INSTRUCTION_SIZE + (first_quad * QUAD_TEMPLATE_SIZE)];
+
+            u8* data = add_region_display_list(array, REGION_VERTEX_FORMAT_INDEX, num_verts, vertex_size);
+            if (indexed) {
+                for (size_t j = 0; j < num_verts * REGION_VERTEX_SIZE; j += REGION_VERTEX_SIZE) {
+                    data = write_index(data, vertex_arrays->position_index_type, get_position_index(mesh_buffers, &vertices[j]));
+                    *data++ = vertices[j + VERTEX_SKY_SHADE_OFFSET];
+                    *data++ = vertices[j + VERTEX_BLOCK_SHADE_OFFSET];
+                    data = write_index(data, vertex_arrays->tex_coord_index_type, get_tex_coord_index(mesh_buffers, &vertices[j]));
+                }
+            } else {
+                memcpy(data, vertices, num_verts * REGION_VERTEX_SIZE);
+            }
+        }
+
+        flush_display_lists(array);
+    }
+
+    if (indexed) {
+        clear_vertex_indices(mesh_buffers);
+    }
+}
+
+static bool is_face_hidden_by_neighbor(voxel_mesh_category_t category, voxel_mesh_category_t neighbor_mesh_category) {
     switch (category) {
-        default: break;
-        case voxel_mesh_category_cube: if (neighbor_mesh_category == voxel_mesh_category_cube) { return indices; } break;
-        case voxel_mesh_category_transparent_cube: if (neighbor_mesh_category == voxel_mesh_category_cube || neighbor_mesh_category == voxel_mesh_category_transparent_cube) { return indices; } break;
+        default: return false;
+        case voxel_mesh_category_cube: return neighbor_mesh_category == voxel_mesh_category_cube;
+        case voxel_mesh_category_transparent_cube: return neighbor_mesh_category == voxel_mesh_category_cube || neighbor_mesh_category == voxel_mesh_category_transparent_cube;
+    }
+}
+
+#define APRON_X_STRIDE (REGION_APRON_SIZE_Y * REGION_APRON_SIZE_Z)
+#define APRON_Y_STRIDE REGION_APRON_SIZE_Z
+// Missing neighbor regions hide every face next to them, like opaque voxels do
+#define MISSING_NEIGHBOR_VOXEL_TYPE voxel_type_stone
+// Missing edge neighbors don't hide any faces, they only leave the ambient occlusion along the region's edges too bright until the region is meshed again with them
+#define MISSING_EDGE_NEIGHBOR_VOXEL_TYPE voxel_type_air
+
+// The 12 edges, then the 8 corners
+const s32vec3s region_edge_neighbor_offsets[NUM_REGION_EDGE_NEIGHBORS] = {
+    {{ 1, 1, 0 }}, {{ 1, -1, 0 }}, {{ -1, 1, 0 }}, {{ -1, -1, 0 }},
+    {{ 1, 0, 1 }}, {{ 1, 0, -1 }}, {{ -1, 0, 1 }}, {{ -1, 0, -1 }},
+    {{ 0, 1, 1 }}, {{ 0, 1, -1 }}, {{ 0, -1, 1 }}, {{ 0, -1, -1 }},
+    {{ 1, 1, 1 }}, {{ 1, 1, -1 }}, {{ 1, -1, 1 }}, {{ 1, -1, -1 }},
+    {{ -1, 1, 1 }}, {{ -1, 1, -1 }}, {{ -1, -1, 1 }}, {{ -1, -1, -1 }}
+};
+
+// Positions just outside the region wrap around to the apron's border, since 1 is added to them
+static size_t get_apron_index(u32 x, u32 y, u32 z) {
+    return ((x + 1) * APRON_X_STRIDE) + ((y + 1) * APRON_Y_STRIDE) + (z + 1);
+}
+
+static u32vec3s get_face_neighbor_position(voxel_face_t face, u32vec3s pos) {
+    switch (face) {
+        default:
+        case voxel_face_front: pos.x++; break;
+        case voxel_face_back: pos.x--; break;
+        case voxel_face_top: pos.y++; break;
+        case voxel_face_bottom: pos.y--; break;
+        case voxel_face_right: pos.z++; break;
+        case voxel_face_left: pos.z--; break;
     }
+    return pos;
+}
+
+// Maps a position on a face layer of the region's border to a voxel local position
+static u32vec3s get_region_border_position(voxel_face_t face, u32 a, u32 b) {
+    switch (face) {
+        default:
+        case voxel_face_front: return (u32vec3s) {{ REGION_SIZE_X - 1, a, b }};
+        case voxel_face_back: return (u32vec3s) {{ 0, a, b }};
+        case voxel_face_top: return (u32vec3s) {{ a, REGION_SIZE_Y - 1, b }};
+        case voxel_face_bottom: return (u32vec3s) {{ a, 0, b }};
+        case voxel_face_right: return (u32vec3s) {{ a, b, REGION_SIZE_Z - 1 }};
+        case voxel_face_left: return (u32vec3s) {{ a, b, 0 }};
+    }
+}
+
+// Sizes of the a and b axes of get_region_border_position
+static u32vec3s get_region_border_size(voxel_face_t face) {
+    switch (face) {
+        default:
+        case voxel_face_front:
+        case voxel_face_back:
+            return (u32vec3s) {{ REGION_SIZE_Y, REGION_SIZE_Z, 0 }};
+        case voxel_face_top:
+        case voxel_face_bottom:
+            return (u32vec3s) {{ REGION_SIZE_X, REGION_SIZE_Z, 0 }};
+        case voxel_face_right:
+        case voxel_face_left:
+            return (u32vec3s) {{ REGION_SIZE_X, REGION_SIZE_Y, 0 }};
+    }
+}
+
+// Size of the region in cells of the level of detail
+static u32vec3s get_lod_region_size(u8 lod) {
+    return (u32vec3s) {{ REGION_SIZE_X >> lod, REGION_SIZE_Y >> lod, REGION_SIZE_Z >> lod }};
+}
+
+// Local positions along one axis of the apron next to an edge neighbor at the given offset on that axis, from begin up to but not including end.
+// Positions just outside the region are -1 and size, so begin wraps around for -1.
+static void get_apron_edge_range(s32 offset, u32 size, u32* begin, u32* end) {
+    if (offset < 0) {
+        *begin = (u32) -1;
+        *end = 0;
+    } else if (offset > 0) {
+        *begin = size;
+        *end = size + 1;
+    } else {
+        *begin = 0;
+        *end = size;
+    }
+}
+
+void copy_region_apron_edges(region_apron_edges_t* apron_edges, const voxel_type_array_t* const edge_neighbor_voxel_types_array[NUM_REGION_EDGE_NEIGHBORS]) {
+    size_t index = 0;
+    for (size_t i = 0; i < NUM_REGION_EDGE_NEIGHBORS; i++) {
+        const voxel_type_array_t* neighbor_voxel_types = edge_neighbor_voxel_types_array[i];
+        u32 begin_x, end_x, begin_y, end_y, begin_z, end_z;
+        get_apron_edge_range(region_edge_neighbor_offsets[i].x, REGION_SIZE_X, &begin_x, &end_x);
+        get_apron_edge_range(region_edge_neighbor_offsets[i].y, REGION_SIZE_Y, &begin_y, &end_y);
+        get_apron_edge_range(region_edge_neighbor_offsets[i].z, REGION_SIZE_Z, &begin_z, &end_z);
+        for (u32 x = begin_x; x != end_x; x++) {
+            for (u32 y = begin_y; y != end_y; y++) {
+                for (u32 z = begin_z; z != end_z; z++) {
+                    apron_edges->voxel_types[index++] = neighbor_voxel_types == NULL ?
+                        MISSING_EDGE_NEIGHBOR_VOXEL_TYPE :
+                        get_voxel_type_from_array(neighbor_voxel_types, (x + REGION_SIZE_X) % REGION_SIZE_X, (y + REGION_SIZE_Y) % REGION_SIZE_Y, (z + REGION_SIZE_Z) % REGION_SIZE_Z);
+                }
+            }
+        }
+    }
+}
+
+// Lookups into the neighbor regions and their bounds checks happen once here instead of for every face.
+// Every cell of the apron is written: the region's voxels, its face neighbors' voxels next to it, and the edges and corners from apron_edges.
+static void fill_voxel_apron(region_mesh_buffers_t* mesh_buffers, const voxel_type_array_t* voxel_types, const voxel_type_array_t* const neighbor_voxel_types_array[6], const region_apron_edges_t* apron_edges) {
+    voxel_type_t* apron = &mesh_buffers->apron[0][0][0];
+
+    if (is_voxel_type_array_uniform(voxel_types)) {
+        for (u32 x = 0; x < REGION_SIZE_X; x++) {
+            for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+                memset(&apron[get_apron_index(x, y, 0)], voxel_types->palette[0], REGION_SIZE_Z);
+            }
+        }
+    } else {
+        for (u32 x = 0; x < REGION_SIZE_X; x++) {
+            for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+                for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                    apron[get_apron_index(x, y, z)] = get_voxel_type_from_array(voxel_types, x, y, z);
+                }
+            }
+        }
+    }
+
+    for (u8 face = 0; face < 6; face++) {
+        const voxel_type_array_t* neighbor_voxel_types = neighbor_voxel_types_array[face];
+        u32vec3s border_size = get_region_border_size((voxel_face_t) face);
+        for (u32 a = 0; a < border_size.x; a++) {
+            for (u32 b = 0; b < border_size.y; b++) {
+                u32vec3s neighbor_pos = get_face_neighbor_position((voxel_face_t) face, get_region_border_position((voxel_face_t) face, a, b));
+                apron[get_apron_index(neighbor_pos.x, neighbor_pos.y, neighbor_pos.z)] = neighbor_voxel_types == NULL ?
+                    MISSING_NEIGHBOR_VOXEL_TYPE :
+                    get_voxel_type_from_array(
+                        neighbor_voxel_types,
+                        // Adding the size first wraps -1 around correctly for sizes that aren't a power of two
+                        (neighbor_pos.x + REGION_SIZE_X) % REGION_SIZE_X,
+                        (neighbor_pos.y + REGION_SIZE_Y) % REGION_SIZE_Y,
+                        (neighbor_pos.z + REGION_SIZE_Z) % REGION_SIZE_Z
+                    );
+            }
+        }
+    }
+
+    // Same order that copy_region_apron_edges copied them in
+    size_t index = 0;
+    for (size_t i = 0; i < NUM_REGION_EDGE_NEIGHBORS; i++) {
+        u32 begin_x, end_x, begin_y, end_y, begin_z, end_z;
+        get_apron_edge_range(region_edge_neighbor_offsets[i].x, REGION_SIZE_X, &begin_x, &end_x);
+        get_apron_edge_range(region_edge_neighbor_offsets[i].y, REGION_SIZE_Y, &begin_y, &end_y);
+        get_apron_edge_range(region_edge_neighbor_offsets[i].z, REGION_SIZE_Z, &begin_z, &end_z);
+        for (u32 x = begin_x; x != end_x; x++) {
+            for (u32 y = begin_y; y != end_y; y++) {
+                for (u32 z = begin_z; z != end_z; z++) {
+                    apron[get_apron_index(x, y, z)] = apron_edges->voxel_types[index++];
+                }
+            }
+        }
+    }
+}
+
+// Faces towards missing neighbor regions are hidden, so their darkness is never seen
+static void fill_voxel_light_apron(region_mesh_buffers_t* mesh_buffers, const voxel_light_array_t* lights, const voxel_light_array_t* const neighbor_lights_array[6]) {
+    voxel_light_t* light_apron = &mesh_buffers->light_apron[0][0][0];
+
+    // The edges and corners aren't in front of any face of the region, so their light is never looked up
+    memset(light_apron, 0, sizeof(mesh_buffers->light_apron));
+
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            if (lights->data == NULL) {
+                memset(&light_apron[get_apron_index(x, y, 0)], lights->uniform_light, REGION_SIZE_Z);
+                continue;
+            }
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                light_apron[get_apron_index(x, y, z)] = get_voxel_light_from_array(lights, x, y, z);
+            }
+        }
+    }
+
+    for (u8 face = 0; face < 6; face++) {
+        const voxel_light_array_t* neighbor_lights = neighbor_lights_array[face];
+        if (neighbor_lights == NULL) {
+            continue;
+        }
+        u32vec3s border_size = get_region_border_size((voxel_face_t) face);
+        for (u32 a = 0; a < border_size.x; a++) {
+            for (u32 b = 0; b < border_size.y; b++) {
+                u32vec3s neighbor_pos = get_face_neighbor_position((voxel_face_t) face, get_region_border_position((voxel_face_t) face, a, b));
+                light_apron[get_apron_index(neighbor_pos.x, neighbor_pos.y, neighbor_pos.z)] = get_voxel_light_from_array(
+                    neighbor_lights,
+                    (neighbor_pos.x + REGION_SIZE_X) % REGION_SIZE_X,
+                    (neighbor_pos.y + REGION_SIZE_Y) % REGION_SIZE_Y,
+                    (neighbor_pos.z + REGION_SIZE_Z) % REGION_SIZE_Z
+                );
+            }
+        }
+    }
+}
+
+// Most common type among the counted ones whose mesh category is in categories, a bitmask of voxel_mesh_category_t
+static voxel_type_t get_most_common_voxel_type(const u8 counts[NUM_VOXEL_TYPES], u32 categories) {
+    voxel_type_t most_common_type = voxel_type_air;
+    u8 most_common_count = 0;
+    for (u8 type = 0; type < NUM_VOXEL_TYPES; type++) {
+        if (counts[type] > most_common_count && (categories & (1u << get_voxel_mesh_category((voxel_type_t) type)))) {
+            most_common_type = (voxel_type_t) type;
+            most_common_count = counts[type];
+        }
+    }
+    return most_common_type;
+}
+
+#define NUM_DOWNSAMPLED_CELL_VOXELS 8
+
+// Range of apron positions along an axis that the downsampled apron position covers.
+// The border of the downsampled apron only covers the border of the current one, which is as far as it reaches.
+static void get_downsampled_apron_range(u32 downsampled_apron_pos, u32 downsampled_size, u32* begin, u32* end) {
+    if (downsampled_apron_pos == 0) {
+        *begin = 0;
+        *end = 1;
+    } else if (downsampled_apron_pos == downsampled_size + 1) {
+        *begin = (downsampled_size * 2) + 1;
+        *end = *begin + 1;
+    } else {
+        *begin = (downsampled_apron_pos * 2) - 1;
+        *end = *begin + 2;
+    }
+}
+
+// Each cell of the next level of detail, including the apron's border, gets the brightest sky and block light of what it covers.
+// Faces are lit by the cell in front of them, which is mostly not opaque where the face is, so this keeps the faces of downsampled meshes lit like they were up close.
+static void downsample_light_apron(region_mesh_buffers_t* mesh_buffers, u32vec3s downsampled_size) {
+    // Like in downsample_voxel_apron, cells are never written before everything they cover has been read
+    for (u32 x = 0; x < downsampled_size.x + 2; x++) {
+        u32 begin_x, end_x;
+        get_downsampled_apron_range(x, downsampled_size.x, &begin_x, &end_x);
+        for (u32 y = 0; y < downsampled_size.y + 2; y++) {
+            u32 begin_y, end_y;
+            get_downsampled_apron_range(y, downsampled_size.y, &begin_y, &end_y);
+            for (u32 z = 0; z < downsampled_size.z + 2; z++) {
+                u32 begin_z, end_z;
+                get_downsampled_apron_range(z, downsampled_size.z, &begin_z, &end_z);
+
+                u8 sky_light = 0;
+                u8 block_light = 0;
+                for (u32 cx = begin_x; cx < end_x; cx++) {
+                    for (u32 cy = begin_y; cy < end_y; cy++) {
+                        for (u32 cz = begin_z; cz < end_z; cz++) {
+                            voxel_light_t light = mesh_buffers->light_apron[cx][cy][cz];
+                            sky_light = get_sky_light(light) > sky_light ? get_sky_light(light) : sky_light;
+                            block_light = get_block_light(light) > block_light ? get_block_light(light) : block_light;
+                        }
+                    }
+                }
+                mesh_buffers->light_apron[x][y][z] = get_voxel_light(sky_light, block_light);
+            }
+        }
+    }
+}
+
+// Replaces the apron's cells with the cells of the next level of detail, each made from 2x2x2 cells of the current one.
+// A cell is filled with its most common cube type if most of its voxels are cubes, or else its most common transparent cube type if most are filled at all.
+// Crosses are too thin to be seen from as far as downsampled meshes are drawn, so they count as air.
+// Cells on the region's border are also filled if any of their voxels on the border is. Then they cover every voxel that a neighbor of a finer level culled its faces against.
+// The apron's border is cleared to air, so the faces on the region's border are always added. Those skirts cover the gaps between neighbors of different levels.
+static void downsample_voxel_apron(region_mesh_buffers_t* mesh_buffers) {
+    u32vec3s size = get_lod_region_size(mesh_buffers->lod);
+    mesh_buffers->lod++;
+    u32vec3s downsampled_size = get_lod_region_size(mesh_buffers->lod);
+
+    downsample_light_apron(mesh_buffers, downsampled_size);
+
+    // A cell is only written after every cell that it was downsampled from has been read, so this can be done in place
+    for (u32 x = 0; x < downsampled_size.x; x++) {
+        for (u32 y = 0; y < downsampled_size.y; y++) {
+            for (u32 z = 0; z < downsampled_size.z; z++) {
+                u8 counts[NUM_VOXEL_TYPES] = { 0 };
+                u32 num_cubes = 0;
+                u32 num_filled = 0;
+                bool border_cube = false;
+                bool border_filled = false;
+                for (u32 i = 0; i < NUM_DOWNSAMPLED_CELL_VOXELS; i++) {
+                    u32 cx = (x * 2) + (i >> 2);
+                    u32 cy = (y * 2) + ((i >> 1) & 1);
+                    u32 cz = (z * 2) + (i & 1);
+                    voxel_type_t type = mesh_buffers->apron[cx + 1][cy + 1][cz + 1];
+                    voxel_mesh_category_t category = get_voxel_mesh_category(type);
+                    if (category != voxel_mesh_category_cube && category != voxel_mesh_category_transparent_cube) {
+                        continue;
+                    }
+
+                    bool on_border = cx == 0 || cy == 0 || cz == 0 || cx == size.x - 1 || cy == size.y - 1 || cz == size.z - 1;
+                    counts[type]++;
+                    num_filled++;
+                    border_filled |= on_border;
+                    if (category == voxel_mesh_category_cube) {
+                        num_cubes++;
+                        border_cube |= on_border;
+                    }
+                }
+
+                voxel_type_t type = voxel_type_air;
+                if (num_cubes * 2 >= NUM_DOWNSAMPLED_CELL_VOXELS || border_cube) {
+                    type = get_most_common_voxel_type(counts, 1u << voxel_mesh_category_cube);
+                } else if (num_filled * 2 >= NUM_DOWNSAMPLED_CELL_VOXELS || border_filled) {
+                    type = get_most_common_voxel_type(counts, (1u << voxel_mesh_category_cube) | (1u << voxel_mesh_category_transparent_cube));
+                }
+                mesh_buffers->apron[x + 1][y + 1][z + 1] = type;
+            }
+        }
+    }
+
+    for (u32 x = 0; x < REGION_APRON_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_APRON_SIZE_Y; y++) {
+            voxel_type_t* row = mesh_buffers->apron[x][y];
+            if (x == 0 || y == 0 || x > downsampled_size.x || y > downsampled_size.y) {
+                memset(row, voxel_type_air, REGION_APRON_SIZE_Z);
+                continue;
+            }
+            row[0] = voxel_type_air;
+            memset(&row[downsampled_size.z + 1], voxel_type_air, REGION_APRON_SIZE_Z - downsampled_size.z - 1);
+        }
+    }
+}
+
+#define REGION_ROW_MASK ((region_row_t) ((1ull << REGION_SIZE_Z) - 1))
+
+// Faces are visible unless is_face_hidden_by_neighbor says otherwise: cube faces are hidden by cubes, transparent cube faces by cubes and transparent cubes.
+// That is worked out for a whole row of voxels at once with their category bitmasks, so only visible faces are looked at one by one.
+// Only the cells of the level of detail and the apron around them are looked at.
+static void fill_visible_face_rows(region_mesh_buffers_t* mesh_buffers) {
+    u32vec3s size = get_lod_region_size(mesh_buffers->lod);
+
+    // Bit z of a row is set if the voxel at apron position [x][y][z] is in the category
+    for (u32 x = 0; x < size.x + 2; x++) {
+        for (u32 y = 0; y < size.y + 2; y++) {
+            region_row_t opaque_row = 0;
+            region_row_t transparent_row = 0;
+            for (u32 z = 0; z < size.z + 2; z++) {
+                voxel_mesh_category_t category = get_voxel_mesh_category(mesh_buffers->apron[x][y][z]);
+                opaque_row |= (region_row_t) (category == voxel_mesh_category_cube) << z;
+                transparent_row |= (region_row_t) (category == voxel_mesh_category_transparent_cube) << z;
+            }
+            mesh_buffers->opaque_rows[x][y] = opaque_row;
+            mesh_buffers->transparent_rows[x][y] = transparent_row;
+        }
+    }
+
+    for (u32 x = 0; x < size.x; x++) {
+        for (u32 y = 0; y < size.y; y++) {
+            u32 ax = x + 1;
+            u32 ay = y + 1;
+            region_row_t opaque_row = mesh_buffers->opaque_rows[ax][ay];
+            region_row_t transparent_row = mesh_buffers->transparent_rows[ax][ay];
+
+            // Ordered by voxel_face_t and shifted so that each bit lines up with the voxel the neighbor is next to
+            region_row_t neighbor_opaque_rows[6] = {
+                mesh_buffers->opaque_rows[ax + 1][ay],
+                mesh_buffers->opaque_rows[ax - 1][ay],
+                mesh_buffers->opaque_rows[ax][ay + 1],
+                mesh_buffers->opaque_rows[ax][ay - 1],
+                opaque_row >> 1,
+                opaque_row << 1
+            };
+            region_row_t neighbor_transparent_rows[6] = {
+                mesh_buffers->transparent_rows[ax + 1][ay],
+                mesh_buffers->transparent_rows[ax - 1][ay],
+                mesh_buffers->transparent_rows[ax][ay + 1],
+                mesh_buffers->transparent_rows[ax][ay - 1],
+                transparent_row >> 1,
+                transparent_row << 1
+            };
+
+            for (u8 face = 0; face < 6; face++) {
+                region_row_t visible_row = (opaque_row & ~neighbor_opaque_rows[face]) | (transparent_row & ~(neighbor_opaque_rows[face] | neighbor_transparent_rows[face]));
+                // Drops the apron's border bits so that bit z is local z
+                mesh_buffers->visible_face_rows[face][x][y] = (visible_row >> 1) & REGION_ROW_MASK;
+            }
+        }
+    }
+}
+
+static bool is_face_visible(const region_mesh_buffers_t* mesh_buffers, u32 x, u32 y, u32 z, voxel_face_t face) {
+    return (mesh_buffers->visible_face_rows[face][x][y] >> z) & 1u;
+}
+
+#define APRON_OFFSET(x, y, z) (((x) * APRON_X_STRIDE) + ((y) * APRON_Y_STRIDE) + (z))
+// Steps from the voxel in front of a face towards a vertex of the face along each of the face's axes, n is the face's normal and c the vertex's corner of the voxel
+#define AO_STEP(n, c) ((n) != 0 ? 0 : ((c) * 2) - 1)
+// Offsets from a voxel in the apron to the voxels touching one vertex of its face in the layer in front of it.
+// The first three are one step along each axis from the voxel in front, one of those is the voxel in front itself since there is no step along the normal. The last is diagonal to the vertex.
+#define AO_VERTEX_OFFSETS(nx, ny, nz, cx, cy, cz) { \
+    APRON_OFFSET((nx) + AO_STEP(nx, cx), ny, nz), \
+    APRON_OFFSET(nx, (ny) + AO_STEP(ny, cy), nz), \
+    APRON_OFFSET(nx, ny, (nz) + AO_STEP(nz, cz)), \
+    APRON_OFFSET((nx) + AO_STEP(nx, cx), (ny) + AO_STEP(ny, cy), (nz) + AO_STEP(nz, cz)) \
+}
+
+// Indexed by voxel_face_t then vertex, with the vertices' corners in the order of FACE_TEMPLATES(1)
+static const s32 ao_vertex_offsets[6][4][4] = {
+    [voxel_face_front] = { AO_VERTEX_OFFSETS(1, 0, 0, 1, 1, 0), AO_VERTEX_OFFSETS(1, 0, 0, 1, 0, 0), AO_VERTEX_OFFSETS(1, 0, 0, 1, 0, 1), AO_VERTEX_OFFSETS(1, 0, 0, 1, 1, 1) },
+    [voxel_face_back] = { AO_VERTEX_OFFSETS(-1, 0, 0, 0, 1, 0), AO_VERTEX_OFFSETS(-1, 0, 0, 0, 1, 1), AO_VERTEX_OFFSETS(-1, 0, 0, 0, 0, 1), AO_VERTEX_OFFSETS(-1, 0, 0, 0, 0, 0) },
+    [voxel_face_top] = { AO_VERTEX_OFFSETS(0, 1, 0, 0, 1, 1), AO_VERTEX_OFFSETS(0, 1, 0, 0, 1, 0), AO_VERTEX_OFFSETS(0, 1, 0, 1, 1, 0), AO_VERTEX_OFFSETS(0, 1, 0, 1, 1, 1) },
+    [voxel_face_bottom] = { AO_VERTEX_OFFSETS(0, -1, 0, 0, 0, 1), AO_VERTEX_OFFSETS(0, -1, 0, 1, 0, 1), AO_VERTEX_OFFSETS(0, -1, 0, 1, 0, 0), AO_VERTEX_OFFSETS(0, -1, 0, 0, 0, 0) },
+    [voxel_face_right] = { AO_VERTEX_OFFSETS(0, 0, 1, 1, 0, 1), AO_VERTEX_OFFSETS(0, 0, 1, 0, 0, 1), AO_VERTEX_OFFSETS(0, 0, 1, 0, 1, 1), AO_VERTEX_OFFSETS(0, 0, 1, 1, 1, 1) },
+    [voxel_face_left] = { AO_VERTEX_OFFSETS(0, 0, -1, 1, 0, 0), AO_VERTEX_OFFSETS(0, 0, -1, 1, 1, 0), AO_VERTEX_OFFSETS(0, 0, -1, 0, 1, 0), AO_VERTEX_OFFSETS(0, 0, -1, 0, 0, 0) }
+};
+
+// A vertex of a face is touched by two voxels along the sides of the face and one diagonal to it in the layer in front of the face.
+// Its ambient occlusion goes from MAX_VERTEX_AO when none of those are opaque down to 0, which it also is if both sides are since they already hide the diagonal one.
+// The voxel in front of a visible face is never opaque, so it can be counted along with the sides.
+static u8 get_face_ao(const region_mesh_buffers_t* mesh_buffers, u32 x, u32 y, u32 z, voxel_face_t face) {
+    const voxel_type_t* voxel = &mesh_buffers->apron[x + 1][y + 1][z + 1];
+    u8 ao = 0;
+    for (size_t i = 0; i < 4; i++) {
+        const s32* offsets = ao_vertex_offsets[face][i];
+        u8 num_opaque_sides = (u8) (is_voxel_type_opaque(voxel[offsets[0]]) + is_voxel_type_opaque(voxel[offsets[1]]) + is_voxel_type_opaque(voxel[offsets[2]]));
+        u8 vertex_ao = num_opaque_sides == 2 ? 0 : (u8) (MAX_VERTEX_AO - num_opaque_sides - is_voxel_type_opaque(voxel[offsets[3]]));
+        ao |= (u8) (vertex_ao << (i * 2));
+    }
+    return ao;
+}
+
+// Offsets from a voxel in the apron to the voxel in front of each of its faces, indexed by voxel_face_t
+static const s32 face_apron_offsets[6] = {
+    APRON_OFFSET(1, 0, 0), APRON_OFFSET(-1, 0, 0), APRON_OFFSET(0, 1, 0), APRON_OFFSET(0, -1, 0), APRON_OFFSET(0, 0, 1), APRON_OFFSET(0, 0, -1)
+};
+
+static voxel_light_t get_face_light(const region_mesh_buffers_t* mesh_buffers, u32 x, u32 y, u32 z, voxel_face_t face) {
+    return (&mesh_buffers->light_apron[0][0][0])[(s32) get_apron_index(x, y, z) + face_apron_offsets[face]];
+}
+
+static void add_face_mesh(region_mesh_buffers_t* mesh_buffers, u32 x, u32 y, u32 z, voxel_type_t type, voxel_mesh_category_t category, voxel_face_t face, u8 length, u8 width, u8 ao, voxel_light_t light) {
+    voxel_mesh_t mesh = {
+        .type = type,
+        .face = face,
+        .x = (u8) x,
+        .y = (u8) y,
+        .z = (u8) z,
+        .length = length,
+        .width = width,
+        .ao = ao,
+        .light = light
+    };
     switch (category) {
         default: break;
         case voxel_mesh_category_cube:
-            building_meshes_arrays.solid[indices.solid++] = (voxel_mesh_t) {
-                .type = (u8) ((type * 8) + face),
-                .x = (u8) x,
-                .y = (u8) y,
-                .z = (u8) z
-            };
+            write_face_mesh(&mesh_buffers->vertex_buffers[REGION_SOLID_DISPLAY_LIST_ARRAYS_INDEX + face], mesh, mesh_buffers->vertex_format, mesh_buffers->lod);
             break;
         case voxel_mesh_category_transparent_cube:
-            building_meshes_arrays.transparent[indices.transparent++] = (voxel_mesh_t) {
-                .type = (u8) ((type * 8) + face),
-                .x = (u8) x,
-                .y = (u8) y,
-                .z = (u8) z
-            };
+            write_face_mesh(&mesh_buffers->vertex_buffers[REGION_TRANSPARENT_DISPLAY_LIST_ARRAY_INDEX], mesh, mesh_buffers->vertex_format, mesh_buffers->lod);
             break;
     }
+}
 
-    return indices;
+static bool is_region_side_hidden(const voxel_type_array_t* neighbor_voxel_types, voxel_mesh_category_t category) {
+    return neighbor_voxel_types == NULL || (is_voxel_type_array_uniform(neighbor_voxel_types) && is_face_hidden_by_neighbor(category, get_voxel_mesh_category(neighbor_voxel_types->palette[0])));
 }
 
-void generate_region_visuals(
+// Sizes of the layer, row and run axes of get_greedy_face_position in cells of the level of detail
+static u32vec3s get_greedy_face_size(voxel_face_t face, u8 lod) {
+    u32vec3s size = get_lod_region_size(lod);
+    switch (face) {
+        default:
+        case voxel_face_front:
+        case voxel_face_back:
+            return (u32vec3s) {{ size.x, size.z, size.y }};
+        case voxel_face_right:
+        case voxel_face_left:
+            return (u32vec3s) {{ size.z, size.x, size.y }};
+        case voxel_face_top:
+            return (u32vec3s) {{ size.y, size.z, size.x }};
+        case voxel_face_bottom:
+            return (u32vec3s) {{ size.y, size.x, size.z }};
+    }
+}
+
+static_assert(NUM_REGION_VOXELS <= 0x10000, "Flood fill indices don't fit in the u16 queue");
+
+// The flood fill state is indexed in [x][y][z] order whatever the voxel layout is, so that queued indices can be turned back into positions
+static size_t get_flood_fill_index(u32 x, u32 y, u32 z) {
+    return (((size_t) x * REGION_SIZE_Y) + y) * REGION_SIZE_Z + z;
+}
+
+// Flood fills the non-opaque voxels and records which region faces each filled area touches, faces touched by the same area can see each other
+static void generate_face_connections(region_mesh_buffers_t* mesh_buffers, const voxel_type_array_t* voxel_types, region_render_info_t* render_info) {
+    if (is_voxel_type_array_uniform(voxel_types)) {
+        memset(render_info->face_connections, is_voxel_type_opaque(voxel_types->palette[0]) ? 0 : ALL_REGION_FACES_CONNECTED, sizeof(render_info->face_connections));
+        return;
+    }
+
+    memset(render_info->face_connections, 0, sizeof(render_info->face_connections));
+
+    u16* queue = mesh_buffers->flood_fill_queue;
+    bool* filled = mesh_buffers->flood_filled;
+    memset(filled, 0, sizeof(mesh_buffers->flood_filled));
+
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                size_t index = get_flood_fill_index(x, y, z);
+                if (filled[index] || is_voxel_type_opaque(get_voxel_type_from_array(voxel_types, x, y, z))) {
+                    continue;
+                }
+
+                size_t head = 0;
+                size_t tail = 0;
+                queue[tail++] = (u16) index;
+                filled[index] = true;
+
+                u8 touched_faces = 0;
+                while (head < tail) {
+                    size_t filled_index = queue[head++];
+                    u32vec3s pos = {{
+                        (u32) (filled_index / (REGION_SIZE_Y * REGION_SIZE_Z)),
+                        (u32) ((filled_index / REGION_SIZE_Z) % REGION_SIZE_Y),
+                        (u32) (filled_index % REGION_SIZE_Z)
+                    }};
+
+                    for (u8 face = 0; face < 6; face++) {
+                        u32vec3s neighbor_pos = get_face_neighbor_position((voxel_face_t) face, pos);
+                        if (neighbor_pos.x >= REGION_SIZE_X || neighbor_pos.y >= REGION_SIZE_Y || neighbor_pos.z >= REGION_SIZE_Z) {
+                            touched_faces |= (u8) (1u << face);
+                            continue;
+                        }
+
+                        size_t neighbor_index = get_flood_fill_index(neighbor_pos.x, neighbor_pos.y, neighbor_pos.z);
+                        if (filled[neighbor_index] || is_voxel_type_opaque(get_voxel_type_from_array(voxel_types, neighbor_pos.x, neighbor_pos.y, neighbor_pos.z))) {
+                            continue;
+                        }
+                        filled[neighbor_index] = true;
+                        queue[tail++] = (u16) neighbor_index;
+                    }
+                }
+
+                for (u8 face = 0; face < 6; face++) {
+                    if (touched_faces & (1u << face)) {
+                        render_info->face_connections[face] |= touched_faces;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void add_cross_meshes(region_mesh_buffers_t* mesh_buffers) {
+    // Downsampled cells are never crosses
+    if (mesh_buffers->lod > 0) {
+        return;
+    }
+
+    for (u32 x = 0; x < REGION_SIZE_X; x++) {
+        for (u32 y = 0; y < REGION_SIZE_Y; y++) {
+            for (u32 z = 0; z < REGION_SIZE_Z; z++) {
+                voxel_type_t type = mesh_buffers->apron[x + 1][y + 1][z + 1];
+                if (get_voxel_mesh_category(type) != voxel_mesh_category_cross) {
+                    continue;
+                }
+                write_cross_mesh(&mesh_buffers->vertex_buffers[REGION_CROSS_DISPLAY_LIST_ARRAY_INDEX], (voxel_mesh_t){
+                    .type = type,
+                    .x = (u8) x,
+                    .y = (u8) y,
+                    .z = (u8) z,
+                    .light = mesh_buffers->light_apron[x + 1][y + 1][z + 1]
+                }, mesh_buffers->vertex_format);
+            }
+        }
+    }
+}
+
+static bool can_merge_greedy_faces(const region_greedy_face_t* face, const region_greedy_face_t* other_face) {
+    return other_face->visible && other_face->type == face->type && other_face->ao == face->ao && other_face->light == face->light;
+}
+
+// Whether every face of a row from run up to run + length can be merged with face
+static bool can_merge_greedy_face_run(const region_mesh_buffers_t* mesh_buffers, const region_greedy_face_t* face, u32 row, u32 run, u32 length) {
+    for (u32 i = run; i < run + length; i++) {
+        if (!can_merge_greedy_faces(face, &mesh_buffers->greedy_faces[row][i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Merges rectangles of visible faces with the same type, ambient occlusion and light in each layer of every face direction.
+// Neighboring faces share the vertices between them, so with the same ambient occlusion it is the same across the whole rectangle and merging doesn't change the shading.
+// Each rectangle starts as the longest run along the run axis, which is then grown along the row axis for as long as the next row has the same run.
+// Only region_vertex_format_tex_gen grows runs into rectangles, since the s texture coordinate of the other formats indexes into the texture atlas and can't repeat.
+// Uniform regions only need their border layers to be looked at.
+static void generate_greedy_region_visuals(
+    region_mesh_buffers_t* mesh_buffers,
     const voxel_type_array_t* voxel_types,
-    const voxel_type_array_t* front_voxel_types,
-    const voxel_type_array_t* back_voxel_types,
-    const voxel_type_array_t* top_voxel_types,
-    const voxel_type_array_t* bottom_voxel_types,
-    const voxel_type_array_t* right_voxel_types,
-    const voxel_type_array_t* left_voxel_types,
-    region_render_info_t* render_info
+    const voxel_type_array_t* const neighbor_voxel_types_array[6],
+    region_mesh_t* mesh
 ) {
-    union {
-        meshes_indices_t all;
-        face_meshes_indices_t face;
-    } indices = {
-        .all = {
-            .solid = 0,
-            .transparent = 0,
-            .transparent_double_sided = 0
+    bool uniform = is_voxel_type_array_uniform(voxel_types);
+    bool merge_rows = mesh_buffers->vertex_format == region_vertex_format_tex_gen;
+    const voxel_type_t* apron = &mesh_buffers->apron[0][0][0];
+
+    for (u8 face_index = 0; face_index < 6; face_index++) {
+        voxel_face_t face = (voxel_face_t) face_index;
+        const voxel_type_array_t* neighbor_voxel_types = neighbor_voxel_types_array[face];
+        u32vec3s size = get_greedy_face_size(face, mesh_buffers->lod);
+
+        u32 begin_layer = 0;
+        u32 end_layer = size.x;
+        if (uniform) {
+            if (is_region_side_hidden(neighbor_voxel_types, get_voxel_mesh_category(voxel_types->palette[0]))) {
+                continue;
+            }
+            // Faces pointing in the positive direction are on the last layer
+            begin_layer = (face == voxel_face_front || face == voxel_face_top || face == voxel_face_right) ? size.x - 1 : 0;
+            end_layer = begin_layer + 1;
         }
-    };
 
-    // Generate mesh for faces that are not neighboring another region.
-    for (u32 x = 0; x < REGION_SIZE; x++) {
-        for (u32 y = 0; y < REGION_SIZE; y++) {
-            for (u32 z = 0; z < REGION_SIZE; z++) {
-                voxel_type_t type = voxel_types->types[x][y][z];
-                voxel_mesh_category_t category = get_voxel_mesh_category(type);
-
-                switch (category) {
-                    default: break;
-                    case voxel_mesh_category_cube:
-                    case voxel_mesh_category_transparent_cube: {
-                        indices.face = add_face_mesh_if_needed(indices.face, voxel_types, right_voxel_types, x, y, z, type, category, voxel_face_right, x, y, z + 1u);
-                        indices.face = add_face_mesh_if_needed(indices.face, voxel_types, left_voxel_types, x, y, z, type, category, voxel_face_left, x, y, z - 1u);
-                        indices.face = add_face_mesh_if_needed(indices.face, voxel_types, top_voxel_types, x, y, z, type, category, voxel_face_top, x, y + 1u, z);
-                        indices.face = add_face_mesh_if_needed(indices.face, voxel_types, bottom_voxel_types, x, y, z, type, category, voxel_face_bottom, x, y - 1u, z);
-                        indices.face = add_face_mesh_if_needed(indices.face, voxel_types, front_voxel_types, x, y, z, type, category, voxel_face_front, x + 1u, y, z);
-                        indices.face = add_face_mesh_if_needed(indices.face, voxel_types, back_voxel_types, x, y, z, type, category, voxel_face_back, x - 1u, y, z);
-                    } break;
-                    case voxel_mesh_category_cross: {
-                        building_meshes_arrays.transparent_double_sided[indices.all.transparent_double_sided++] = (voxel_mesh_t){
-                            .type = (u8) type,
-                            .x = (u8) x,
-                            .y = (u8) y,
-                            .z = (u8) z
-                        };
-                    } break;
+        for (u32 layer = begin_layer; layer < end_layer; layer++) {
+            for (u32 row = 0; row < size.y; row++) {
+                for (u32 run = 0; run < size.z; run++) {
+                    u32vec3s pos = get_greedy_face_position(face, layer, row, run);
+                    region_greedy_face_t* greedy_face = &mesh_buffers->greedy_faces[row][run];
+                    greedy_face->visible = is_face_visible(mesh_buffers, pos.x, pos.y, pos.z, face);
+                    if (greedy_face->visible) {
+                        greedy_face->type = apron[get_apron_index(pos.x, pos.y, pos.z)];
+                        greedy_face->ao = get_face_ao(mesh_buffers, pos.x, pos.y, pos.z, face);
+                        greedy_face->light = get_face_light(mesh_buffers, pos.x, pos.y, pos.z, face);
+                    }
                 }
+            }
 
-                if (indices.all.solid >= (NUM_SOLID_BUILDING_MESHES - 6)) {
-                    write_meshes_into_display_list(0, indices.all.solid, indices.all.solid * 4, building_meshes_arrays.solid, render_info);
-                    indices.all.solid = 0;
-                }
-                if (indices.all.transparent >= (NUM_TRANSPARENT_BUILDING_MESHES - 6)) {
-                    write_meshes_into_display_list(1, indices.all.transparent, indices.all.transparent * 4, building_meshes_arrays.transparent, render_info);
-                    indices.all.transparent = 0;
+            for (u32 row = 0; row < size.y; row++) {
+                for (u32 run = 0; run < size.z; run++) {
+                    region_greedy_face_t first_face = mesh_buffers->greedy_faces[row][run];
+                    if (!first_face.visible) {
+                        continue;
+                    }
+
+                    u32 length = 1;
+                    while (run + length < size.z && can_merge_greedy_faces(&first_face, &mesh_buffers->greedy_faces[row][run + length])) {
+                        length++;
+                    }
+                    u32 width = 1;
+                    while (merge_rows && row + width < size.y && can_merge_greedy_face_run(mesh_buffers, &first_face, row + width, run, length)) {
+                        width++;
+                    }
+
+                    // The merged faces of the rows after this one are skipped when their rows are reached
+                    for (u32 merged_row = row + 1; merged_row < row + width; merged_row++) {
+                        for (u32 merged_run = run; merged_run < run + length; merged_run++) {
+                            mesh_buffers->greedy_faces[merged_row][merged_run].visible = false;
+                        }
+                    }
+
+                    u32vec3s pos = get_greedy_face_position(face, layer, row, run);
+                    add_face_mesh(mesh_buffers, pos.x, pos.y, pos.z, first_face.type, get_voxel_mesh_category(first_face.type), face, (u8) length, (u8) width, first_face.ao, first_face.light);
+                    run += length - 1;
                 }
-                if (indices.all.transparent_double_sided >= (NUM_TRANSPARENT_DOUBLE_SIDED_BUILDING_MESHES - 1)) {
-                    write_meshes_into_display_list(2, indices.all.transparent_double_sided, indices.all.transparent_double_sided * 8, building_meshes_arrays.transparent_double_sided, render_info);
-                    indices.all.transparent_double_sided = 0;
+            }
+        }
+    }
+
+    if (!uniform || get_voxel_mesh_category(voxel_types->palette[0]) == voxel_mesh_category_cross) {
+        add_cross_meshes(mesh_buffers);
+    }
+
+    write_vertex_buffers_into_display_lists(mesh_buffers, mesh);
+}
+
+static void generate_per_face_region_visuals(region_mesh_buffers_t* mesh_buffers, region_mesh_t* mesh) {
+    u32vec3s size = get_lod_region_size(mesh_buffers->lod);
+    for (u8 face = 0; face < 6; face++) {
+        for (u32 x = 0; x < size.x; x++) {
+            for (u32 y = 0; y < size.y; y++) {
+                region_row_t visible_row = mesh_buffers->visible_face_rows[face][x][y];
+                while (visible_row != 0) {
+                    u32 z = (u32) GET_REGION_ROW_CTZ(visible_row);
+                    visible_row &= visible_row - 1;
+
+                    voxel_type_t type = mesh_buffers->apron[x + 1][y + 1][z + 1];
+                    add_face_mesh(mesh_buffers, x, y, z, type, get_voxel_mesh_category(type), (voxel_face_t) face, 1, 1, get_face_ao(mesh_buffers, x, y, z, (voxel_face_t) face), get_face_light(mesh_buffers, x, y, z, (voxel_face_t) face));
                 }
             }
         }
     }
 
-    if (indices.all.solid > 0) {
-        write_meshes_into_display_list(0, indices.all.solid, indices.all.solid * 4, building_meshes_arrays.solid, render_info);
+    add_cross_meshes(mesh_buffers);
+
+    write_vertex_buffers_into_display_lists(mesh_buffers, mesh);
+}
+
+static u64 hash_apron_row(u64 hash, const u8* bytes, size_t num_bytes) {
+    size_t i = 0;
+    for (; i + sizeof(u32) <= num_bytes; i += sizeof(u32)) {
+        u32 word;
+        memcpy(&word, &bytes[i], sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
     }
-    if (indices.all.transparent > 0) {
-        write_meshes_into_display_list(1, indices.all.transparent, indices.all.transparent * 4, building_meshes_arrays.transparent, render_info);
+    for (; i < num_bytes; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
     }
-    if (indices.all.transparent_double_sided > 0) {
-        write_meshes_into_display_list(2, indices.all.transparent_double_sided, indices.all.transparent_double_sided * 8, building_meshes_arrays.transparent_double_sided, render_info);
+    return hash;
+}
+
+// The apron and light apron hold everything that the mesh is made from, so equal aprons meshed the same way give byte identical meshes.
+// Downsampled aprons are air outside of their cells and the border around them, so only that part is hashed.
+// This is FNV-1a over whole words to keep it cheap next to meshing, with a final mix since words only carry their bits upwards.
+// Collisions are unlikely enough with 64 bits that aprons aren't compared on a hit.
+static u64 get_region_mesh_hash(const region_mesh_buffers_t* mesh_buffers) {
+    u64 hash = 0xcbf29ce484222325ull;
+    hash = (hash ^ (u64) region_mesher) * 0x100000001b3ull;
+    hash = (hash ^ (u64) mesh_buffers->vertex_format) * 0x100000001b3ull;
+    hash = (hash ^ (u64) mesh_buffers->lod) * 0x100000001b3ull;
+
+    u32vec3s size = get_lod_region_size(mesh_buffers->lod);
+    size_t num_row_bytes = size.z + 2;
+    for (u32 x = 0; x < size.x + 2; x++) {
+        for (u32 y = 0; y < size.y + 2; y++) {
+            hash = hash_apron_row(hash, (const u8*) mesh_buffers->apron[x][y], num_row_bytes);
+            hash = hash_apron_row(hash, mesh_buffers->light_apron[x][y], num_row_bytes);
+        }
     }
-}
\ No newline at end of file
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Shares the mesh of the apron's current level of detail from the cache, or meshes and caches it
+static void generate_region_mesh(
+    region_mesh_buffers_t* mesh_buffers,
+    const voxel_type_array_t* voxel_types,
+    const voxel_type_array_t* const neighbor_voxel_types_array[6],
+    region_mesh_t* mesh
+) {
+    u64 mesh_hash = get_region_mesh_hash(mesh_buffers);
+    if (share_cached_region_mesh(mesh_hash, mesh)) {
+        return;
+    }
+
+    reset_region_vertex_buffers(mesh_buffers);
+    fill_visible_face_rows(mesh_buffers);
+
+    if (region_mesher == region_mesher_greedy) {
+        generate_greedy_region_visuals(mesh_buffers, voxel_types, neighbor_voxel_types_array, mesh);
+    } else {
+        generate_per_face_region_visuals(mesh_buffers, mesh);
+    }
+
+    // Meshes without any visible faces have nothing worth sharing
+    if (get_region_mesh_num_bytes(mesh) > 0) {
+        add_region_mesh_to_cache(mesh_hash, mesh);
+    }
+}
+
+void generate_region_visuals(
+    region_mesh_buffers_t* mesh_buffers,
+    const voxel_type_array_t* voxel_types,
+    const voxel_type_array_t* const neighbor_voxel_types_array[6],
+    const region_apron_edges_t* apron_edges,
+    const voxel_light_array_t* lights,
+    const voxel_light_array_t* const neighbor_lights_array[6],
+    region_render_info_t* render_info
+) {
+    generate_face_connections(mesh_buffers, voxel_types, render_info);
+    mesh_buffers->vertex_format = region_vertex_format;
+    mesh_buffers->lod = 0;
+    render_info->num_lod_meshes = 1;
+
+    if (is_voxel_type_array_uniform(voxel_types) && get_voxel_mesh_category(voxel_types->palette[0]) == voxel_mesh_category_invisible) {
+        return;
+    }
+
+    fill_voxel_apron(mesh_buffers, voxel_types, neighbor_voxel_types_array, apron_edges);
+    fill_voxel_light_apron(mesh_buffers, lights, neighbor_lights_array);
+    generate_region_mesh(mesh_buffers, voxel_types, neighbor_voxel_types_array, &render_info->lod_meshes[0]);
+
+    if (is_voxel_type_array_uniform(voxel_types)) {
+        return;
+    }
+
+    for (u8 lod = 1; lod < NUM_REGION_LODS; lod++) {
+        downsample_voxel_apron(mesh_buffers);
+        generate_region_mesh(mesh_buffers, voxel_types, neighbor_voxel_types_array, &render_info->lod_meshes[lod]);
+    }
+    render_info->num_lod_meshes = NUM_REGION_LODS;
+}
+
+static void free_region_mesh(region_mesh_t* mesh) {
+    // A shared mesh is only freed along with the last region sharing it
+    bool owns_mesh = mesh->mesh_cache_entry == NULL || release_cached_region_mesh(mesh->mesh_cache_entry);
+    mesh->mesh_cache_entry = NULL;
+
+    for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+        region_display_list_array_t* array = &mesh->display_list_arrays[i];
+        if (owns_mesh) {
+            for (size_t j = 0; j < array->num_display_lists; j++) {
+                free_display_list((void*) array->display_lists[j].data, array->display_lists[j].num_bytes);
+            }
+            free(array->display_lists);
+        }
+        array->display_lists = NULL;
+        array->num_display_lists = 0;
+    }
+    if (owns_mesh && mesh->vertex_arrays.data != NULL) {
+        free_display_list(mesh->vertex_arrays.data, mesh->vertex_arrays.num_bytes);
+    }
+    mesh->vertex_arrays = (region_vertex_arrays_t) { .data = NULL };
+}
+
+void free_region_visuals(region_render_info_t* render_info) {
+    for (size_t i = 0; i < NUM_REGION_LODS; i++) {
+        free_region_mesh(&render_info->lod_meshes[i]);
+    }
+    render_info->num_lod_meshes = 1;
+    memset(render_info->face_connections, ALL_REGION_FACES_CONNECTED, sizeof(render_info->face_connections));
+}
+
+size_t get_region_mesh_num_bytes(const region_mesh_t* mesh) {
+    size_t num_bytes = mesh->vertex_arrays.num_bytes;
+    for (size_t i = 0; i < NUM_REGION_DISPLAY_LIST_ARRAYS; i++) {
+        const region_display_list_array_t* array = &mesh->display_list_arrays[i];
+        for (size_t j = 0; j < array->num_display_lists; j++) {
+            num_bytes += array->display_lists[j].num_bytes;
+        }
+    }
+    return num_bytes;
+}
+
+size_t get_region_visuals_num_bytes(const region_render_info_t* render_info) {
+    size_t num_bytes = 0;
+    for (size_t i = 0; i < render_info->num_lod_meshes; i++) {
+        num_bytes += get_region_mesh_num_bytes(&render_info->lod_meshes[i]);
+    }
+    return num_bytes;
+}
@@ -1,14 +1,121 @@
 #pragma once
+#include "asset.h"
 #include "game/region.h"
 #include <cglm/struct/vec3.h>
 
+typedef enum {
+    // One quad per visible voxel face
+    region_mesher_per_face,
+    // Coplanar neighboring faces with the same voxel type, ambient occlusion and light are merged into one quad.
+    // With region_vertex_format_tex_gen they are merged into rectangles, with the other formats only into runs along the texture's t axis, since s indexes into the texture atlas.
+    region_mesher_greedy
+} region_mesher_t;
+
+extern region_mesher_t region_mesher;
+
+extern region_vertex_format_t region_vertex_format;
+
+typedef struct {
+    u8* data;
+    size_t num_bytes;
+    size_t num_allocated_bytes;
+} region_vertex_buffer_t;
+
+#define REGION_APRON_SIZE_X (REGION_SIZE_X + 2)
+#define REGION_APRON_SIZE_Y (REGION_SIZE_Y + 2)
+#define REGION_APRON_SIZE_Z (REGION_SIZE_Z + 2)
+
+// Regions that touch a region only along one of its 12 edges or at one of its 8 corners
+#define NUM_REGION_EDGE_NEIGHBORS 20
+// Offsets of the edge neighbors from the region, in the order that region_apron_edges_t holds their voxels
+extern const s32vec3s region_edge_neighbor_offsets[NUM_REGION_EDGE_NEIGHBORS];
+
+#define NUM_REGION_APRON_EDGE_VOXELS ((4 * (REGION_SIZE_X + REGION_SIZE_Y + REGION_SIZE_Z)) + 8)
+
+// The voxels of the edge neighbors along the apron's edges and corners, which ambient occlusion along the region's edges is worked out from.
+// Copied out of the edge neighbors by copy_region_apron_edges, so that meshing a region doesn't need them whole.
+typedef struct {
+    voxel_type_t voxel_types[NUM_REGION_APRON_EDGE_VOXELS];
+} region_apron_edges_t;
+
+// Bitmask of a row of apron voxels along z
+#if REGION_APRON_SIZE_Z <= 32
+typedef u32 region_row_t;
+#define GET_REGION_ROW_CTZ(row) __builtin_ctz(row)
+#elif REGION_APRON_SIZE_Z <= 64
+typedef u64 region_row_t;
+#define GET_REGION_ROW_CTZ(row) __builtin_ctzll(row)
+#else
+#error "Apron rows don't fit in a u64"
+#endif
+
+// Vertex positions are on the corners of voxels
+#define NUM_REGION_VERTEX_POSITIONS ((REGION_SIZE_X + 1) * (REGION_SIZE_Y + 1) * (REGION_SIZE_Z + 1))
+// Texture coordinates have an s of a tile or the tile after it, and a t of up to the length of the longest merged face, which is as long as the region at most
+#define NUM_REGION_VERTEX_TEX_COORDS ((NUM_REGION_TEXTURE_TILES + 1) * (MAX_REGION_SIZE + 1))
+
+// A face in the layer that region_mesher_greedy is merging
+typedef struct {
+    voxel_type_t type;
+    u8 ao;
+    voxel_light_t light;
+    // Cleared once the face has been merged into a quad
+    bool visible;
+} region_greedy_face_t;
+
+// Scratch space that a region's vertices are written into before being copied into display lists, along with the flood fill state used for face connections.
+// Every thread that generates region visuals needs its own.
+typedef struct {
+    // Indexed like region_render_info_t's display list arrays
+    region_vertex_buffer_t vertex_buffers[NUM_REGION_DISPLAY_LIST_ARRAYS];
+    // The region's voxel types surrounded by a one voxel border copied from its neighbors, so neighbors are read at fixed offsets.
+    // The voxel at local position (x, y, z) is at [x + 1][y + 1][z + 1].
+    voxel_type_t apron[REGION_APRON_SIZE_X][REGION_APRON_SIZE_Y][REGION_APRON_SIZE_Z];
+    // The lights of the voxels in apron, faces are lit by the voxel in front of them
+    voxel_light_t light_apron[REGION_APRON_SIZE_X][REGION_APRON_SIZE_Y][REGION_APRON_SIZE_Z];
+    // Bitmasks along z of the apron's opaque and transparent voxels, indexed like apron
+    region_row_t opaque_rows[REGION_APRON_SIZE_X][REGION_APRON_SIZE_Y];
+    region_row_t transparent_rows[REGION_APRON_SIZE_X][REGION_APRON_SIZE_Y];
+    // Bitmasks along z of the voxels whose face is visible, indexed [voxel_face_t][x][y] by local position
+    region_row_t visible_face_rows[6][REGION_SIZE_X][REGION_SIZE_Y];
+    // The faces of the layer that region_mesher_greedy is merging, indexed [row][run] along the axes of get_greedy_face_position
+    region_greedy_face_t greedy_faces[MAX_REGION_SIZE][MAX_REGION_SIZE];
+    u16 flood_fill_queue[NUM_REGION_VOXELS];
+    bool flood_filled[NUM_REGION_VOXELS];
+    // Used to deduplicate vertices for region_vertex_format_indexed.
+    // The lookups hold 1 + the index of each position and texture coordinate added so far, or 0, and are cleared again after every region.
+    u16 position_indices[REGION_SIZE_X + 1][REGION_SIZE_Y + 1][REGION_SIZE_Z + 1];
+    u16 tex_coord_indices[NUM_REGION_TEXTURE_TILES + 1][MAX_REGION_SIZE + 1];
+    u8 positions[NUM_REGION_VERTEX_POSITIONS][3];
+    u8 tex_coords[NUM_REGION_VERTEX_TEX_COORDS][2];
+    u16 num_positions;
+    u16 num_tex_coords;
+    // Read from region_vertex_format once per region, so that a region is meshed with one format even if it is switched meanwhile
+    region_vertex_format_t vertex_format;
+    // Level of detail that the apron currently holds the cells of, positions in the apron and the visible face rows are in its cells
+    u8 lod;
+} region_mesh_buffers_t;
+
+// Also resets the face connections to fully connected, since nothing is known about a region until it is meshed
+void free_region_visuals(region_render_info_t* render_info);
+
+// Bytes of display lists and vertex arrays that the mesh takes up
+size_t get_region_mesh_num_bytes(const region_mesh_t* mesh);
+// Bytes of display lists and vertex arrays that the meshes of every level of detail of the region take up
+size_t get_region_visuals_num_bytes(const region_render_info_t* render_info);
+
+// Ordered like region_edge_neighbor_offsets, NULL for edge neighbors that aren't loaded
+void copy_region_apron_edges(region_apron_edges_t* apron_edges, const voxel_type_array_t* const edge_neighbor_voxel_types_array[NUM_REGION_EDGE_NEIGHBORS]);
+
+// Safe to call from any thread as long as mesh_buffers and the voxel type and light arrays aren't shared with another thread
 void generate_region_visuals(
+    region_mesh_buffers_t* mesh_buffers,
     const voxel_type_array_t* voxel_types,
-    const voxel_type_array_t* front_voxel_types,
-    const voxel_type_array_t* back_voxel_types,
-    const voxel_type_array_t* top_voxel_types,
-    const voxel_type_array_t* bottom_voxel_types,
-    const voxel_type_array_t* right_voxel_types,
-    const voxel_type_array_t* left_voxel_types,
+    // Ordered by voxel_face_t, NULL for neighbors that aren't loaded
+    const voxel_type_array_t* const neighbor_voxel_types_array[6],
+    const region_apron_edges_t* apron_edges,
+    const voxel_light_array_t* lights,
+    // Ordered like neighbor_voxel_types_array
+    const voxel_light_array_t* const neighbor_lights_array[6],
     region_render_info_t* render_info
 );
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "region_worker.h"
+#include "game/region.h"
+#include "game/region_lighting.h"
+#include "game/region_procedural_generation.h"
+#include "game/region_visual_generation.h"
+#include "chrono.h"
+#include <ogc/lwp.h>
+#include <ogc/semaphore.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+// The main thread runs at priority 64, so the worker only runs while the main thread is waiting on the GPU or vsync
+#define WORKER_PRIORITY 32
+#define WORKER_STACK_SIZE (64 * 1024)
+
+#define NUM_QUEUED_REGION_JOBS 64
+
+// Lock-free single producer single consumer ring buffer, tail is only written by the producer and head only by the consumer
+typedef struct {
+    region_job_t jobs[NUM_QUEUED_REGION_JOBS];
+    atomic_size_t head;
+    atomic_size_t tail;
+} region_job_queue_t;
+
+static region_job_queue_t pending_jobs;
+static region_job_queue_t finished_jobs;
+// Counts the pending jobs so the worker can sleep while there are none
+static sem_t pending_jobs_semaphore;
+static lwp_t worker_thread;
+
+static region_mesh_buffers_t mesh_buffers;
+static region_light_buffers_t light_buffers;
+
+static bool push_job(region_job_queue_t* queue, const region_job_t* job) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == NUM_QUEUED_REGION_JOBS) {
+        return false;
+    }
+
+    queue->jobs[tail % NUM_QUEUED_REGION_JOBS] = *job;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool pop_job(region_job_queue_t* queue, region_job_t* job) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *job = queue->jobs[head % NUM_QUEUED_REGION_JOBS];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void run_job(region_job_t* job) {
+    s64 start = get_current_us();
+
+    switch (job->type) {
+        case region_job_type_generate:
+            generate_region_voxels(job->region_pos, &job->voxel_types);
+            light_region_voxels(&light_buffers, &job->voxel_types, job->above_sky_lights, &job->lights);
+            break;
+        case region_job_type_mesh: {
+            const voxel_type_array_t* neighbor_voxel_types[6];
+            const voxel_light_array_t* neighbor_lights[6];
+            for (size_t i = 0; i < 6; i++) {
+                neighbor_voxel_types[i] = job->has_neighbor_voxel_types[i] ? &job->neighbor_voxel_types[i] : NULL;
+                neighbor_lights[i] = job->has_neighbor_voxel_types[i] ? &job->neighbor_lights[i] : NULL;
+            }
+
+            generate_region_visuals(
+                &mesh_buffers,
+                &job->voxel_types,
+                neighbor_voxel_types,
+                &job->apron_edges,
+                &job->lights,
+                neighbor_lights,
+                &job->render_info
+            );
+
+            // The copies are only needed while meshing
+            free_voxel_type_array(&job->voxel_types);
+            free_voxel_light_array(&job->lights);
+            for (size_t i = 0; i < 6; i++) {
+                free_voxel_type_array(&job->neighbor_voxel_types[i]);
+                free_voxel_light_array(&job->neighbor_lights[i]);
+            }
+        } break;
+    }
+
+    job->time = (us_t) (get_current_us() - start);
+}
+
+static void* run_worker(void*) {
+    for (;;) {
+        LWP_SemWait(pending_jobs_semaphore);
+
+        region_job_t job;
+        if (!pop_job(&pending_jobs, &job)) {
+            continue;
+        }
+
+        run_job(&job);
+
+        // The main thread drains the finished jobs every frame, so this only spins if it is far behind
+        while (!push_job(&finished_jobs, &job)) {
+            LWP_YieldThread();
+        }
+    }
+    return NULL;
+}
+
+void init_region_worker(void) {
+    atomic_init(&pending_jobs.head, 0);
+    atomic_init(&pending_jobs.tail, 0);
+    atomic_init(&finished_jobs.head, 0);
+    atomic_init(&finished_jobs.tail, 0);
+
+    LWP_SemInit(&pending_jobs_semaphore, 0, NUM_QUEUED_REGION_JOBS);
+    LWP_CreateThread(&worker_thread, run_worker, NULL, NULL, WORKER_STACK_SIZE, WORKER_PRIORITY);
+}
+
+bool push_region_job(const region_job_t* job) {
+    if (!push_job(&pending_jobs, job)) {
+        return false;
+    }
+    LWP_SemPost(pending_jobs_semaphore);
+    return true;
+}
+
+bool pop_finished_region_job(region_job_t* job) {
+    return pop_job(&finished_jobs, job);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "game/region.h"
+#include "game/region_visual_generation.h"
+#include "chrono.h"
+#include "game_math.h"
+
+typedef enum {
+    // Generates the voxels of a newly loaded region and lights it
+    region_job_type_generate,
+    // Generates the visuals of a region from copies of its and its neighbors' voxels
+    region_job_type_mesh
+} region_job_type_t;
+
+typedef struct {
+    region_job_type_t type;
+    s32vec3s region_pos;
+    u32vec3s region_slot_pos;
+    // The slot's epoch when the job was pushed, used to drop results for slots that have changed since
+    u32 epoch;
+    // Filled in by generate jobs, mesh jobs own a copy of the region's voxels here
+    voxel_type_array_t voxel_types;
+    // Only used by generate jobs, which light the region as if sky light came down from these as they were when the job was pushed
+    u8 above_sky_lights[REGION_SIZE_X][REGION_SIZE_Z];
+    // Ordered by voxel_face_t and only used by mesh jobs
+    voxel_type_array_t neighbor_voxel_types[6];
+    bool has_neighbor_voxel_types[6];
+    // Only used by mesh jobs, copied from the diagonal neighbors since the job doesn't own copies of them
+    region_apron_edges_t apron_edges;
+    // Filled in by generate jobs as far as light spreads inside the region, mesh jobs own copies of the region's and its loaded neighbors' lights here
+    voxel_light_array_t lights;
+    voxel_light_array_t neighbor_lights[6];
+    // Filled in by mesh jobs
+    region_render_info_t render_info;
+    us_t time;
+} region_job_t;
+
+// Starts the worker thread that region voxel generation and meshing run on
+void init_region_worker(void);
+// The worker takes ownership of the job's voxel type and light arrays. Returns false if the queue is full.
+bool push_region_job(const region_job_t* job);
+// Returns false if no job has finished, otherwise the caller takes ownership of the finished job
+bool pop_finished_region_job(region_job_t* job);
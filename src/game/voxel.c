@@ -9,8 +9,8 @@ s32vec3s get_voxel_world_position(vec3s world_pos) {
 
 u32vec3s get_voxel_local_position_from_voxel_world_position(s32vec3s voxel_world_pos) {
     return (u32vec3s) {{
-        (u32) mod_s32(voxel_world_pos.x, REGION_SIZE),
-        (u32) mod_s32(voxel_world_pos.y, REGION_SIZE),
-        (u32) mod_s32(voxel_world_pos.z, REGION_SIZE),
+        (u32) mod_s32(voxel_world_pos.x, REGION_SIZE_X),
+        (u32) mod_s32(voxel_world_pos.y, REGION_SIZE_Y),
+        (u32) mod_s32(voxel_world_pos.z, REGION_SIZE_Z),
     }};
 }
\ No newline at end of file
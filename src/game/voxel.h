@@ -12,9 +12,12 @@ typedef enum __attribute__((__packed__)) {
     voxel_type_wood_planks,
     voxel_type_stone_slab_both,
     voxel_type_water,
-    voxel_type_tall_grass
+    voxel_type_tall_grass,
+    voxel_type_glowstone
 } voxel_type_t;
 
+#define NUM_VOXEL_TYPES (voxel_type_glowstone + 1)
+
 typedef enum __attribute__((__packed__)) {
     voxel_face_front, // +x
     voxel_face_back, // -x
@@ -24,6 +27,11 @@ typedef enum __attribute__((__packed__)) {
     voxel_face_left // -z
 } voxel_face_t;
 
+typedef struct {
+    bool success;
+    voxel_type_t val;
+} voxel_type_wrap_t;
+
 static_assert(sizeof(voxel_type_t) == 1, "");
 static_assert(sizeof(voxel_face_t) == 1, "");
 
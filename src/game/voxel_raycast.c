@@ -3,7 +3,9 @@
 #include "game/region_management.h"
 #include "game_math.h"
 #include "util.h"
+#include "chrono.h"
 #include "voxel.h"
+#include "voxel_type_info.h"
 
 static voxel_raycast_wrap_t get_closest_raycast(voxel_raycast_wrap_t closest_raycast, s32vec3s voxel_world_pos, box_raycast_wrap_t box_raycast) {
     if (
@@ -22,40 +24,47 @@ static voxel_raycast_wrap_t get_closest_raycast(voxel_raycast_wrap_t closest_ray
     };
 }
 
+static bool does_voxel_type_have_box(voxel_type_t voxel_type, voxel_box_type_t box_type) {
+    const voxel_type_info_t* info = get_voxel_type_info(voxel_type);
+    return box_type == voxel_box_type_collision ? info->has_collision_box : info->has_selection_box;
+}
+
 static box_raycast_wrap_t get_box_raycast_for_voxel(vec3s origin, vec3s dir, vec3s dir_inv, vec3s box_transform, voxel_box_type_t box_type, vec3s world_pos, voxel_type_t voxel_type) {
-    box_t box;
-    switch (voxel_type) {
-        case voxel_type_air: return (box_raycast_wrap_t) { .success = false };
-        case voxel_type_tall_grass:
-            if (box_type == voxel_box_type_collision) {
-                return (box_raycast_wrap_t) { .success = false };
-            }
-            box = (box_t) {
-                { .x = 0.2f, .y = 0.0f, .z = 0.2f },
-                { .x = 0.8f, .y = 0.8f, .z = 0.8f }
-            }; break;
-        case voxel_type_water:
-            if (box_type == voxel_box_type_collision) {
-                return (box_raycast_wrap_t) { .success = false };
-            }
-            box = (box_t) {
-                { .x = 0.0f, .y = 0.0f, .z = 0.0f },
-                { .x = 1.0f, .y = 1.0f, .z = 1.0f }
-            }; break;
-        default:
-            box = (box_t) {
-                { .x = 0.0f, .y = 0.0f, .z = 0.0f },
-                { .x = 1.0f, .y = 1.0f, .z = 1.0f }
-            }; break;
+    if (!does_voxel_type_have_box(voxel_type, box_type)) {
+        return (box_raycast_wrap_t) { .success = false };
     }
 
+    const voxel_type_info_t* info = get_voxel_type_info(voxel_type);
+    box_t box = box_type == voxel_box_type_collision ? info->collision_box : info->selection_box;
+
     box.lesser_corner = glms_vec3_add(glms_vec3_sub(box.lesser_corner, box_transform), world_pos);
     box.greater_corner = glms_vec3_add(glms_vec3_add(box.greater_corner, box_transform), world_pos);
 
     return get_box_raycast(origin, dir, dir_inv, box);
 }
 
-voxel_raycast_wrap_t get_voxel_raycast(vec3s origin, vec3s dir, vec3s begin, vec3s end, vec3s box_transform, voxel_box_type_t box_type) {
+// Uniform regions of a type without a box (e.g. all air) can never be hit, so there is no need to look at their voxels one by one
+static bool can_regions_be_hit(vec3s floored_begin, vec3s floored_end, voxel_box_type_t box_type) {
+    s32vec3s begin_region_pos = get_region_position_from_voxel_world_position(get_voxel_world_position(floored_begin));
+    s32vec3s end_region_pos = get_region_position_from_voxel_world_position(get_voxel_world_position(floored_end));
+
+    for (s32 x = begin_region_pos.x; x <= end_region_pos.x; x++) {
+        for (s32 y = begin_region_pos.y; y <= end_region_pos.y; y++) {
+            for (s32 z = begin_region_pos.z; z <= end_region_pos.z; z++) {
+                const voxel_type_array_t* voxel_types = get_voxel_type_array_from_region_position((s32vec3s) {{ x, y, z }});
+                if (voxel_types == NULL) {
+                    continue;
+                }
+                if (!is_voxel_type_array_uniform(voxel_types) || does_voxel_type_have_box(voxel_types->palette[0], box_type)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+static voxel_raycast_wrap_t get_voxel_raycast_in_range(vec3s origin, vec3s dir, vec3s begin, vec3s end, vec3s box_transform, voxel_box_type_t box_type) {
     voxel_raycast_wrap_t closest_raycast = { .success = false };
 
     vec3s dir_inv = glms_vec3_div((vec3s){ .x = 1.0f, .y = 1.0f, .z = 1.0f }, dir);
@@ -81,22 +90,33 @@ voxel_raycast_wrap_t get_voxel_raycast(vec3s origin, vec3s dir, vec3s begin, vec
         floored_end.z = temp;
     }
 
+    if (!can_regions_be_hit(floored_begin, floored_end, box_type)) {
+        return closest_raycast;
+    }
+
     for (f32 x = floored_begin.x; x <= floored_end.x; x++) {
         for (f32 y = floored_begin.y; y <= floored_end.y; y++) {
             for (f32 z = floored_begin.z; z <= floored_end.z; z++) {
                 vec3s world_pos = (vec3s) {{ x, y, z }};
                 s32vec3s voxel_world_pos = get_voxel_world_position(world_pos);
 
-                voxel_type_t* voxel_type = get_voxel_type_from_voxel_world_position(voxel_world_pos);
-                if (voxel_type == NULL) {
+                voxel_type_wrap_t voxel_type = get_voxel_type_from_voxel_world_position(voxel_world_pos);
+                if (!voxel_type.success) {
                     continue;
                 }
                 
-                box_raycast_wrap_t box_raycast = get_box_raycast_for_voxel(origin, dir, dir_inv, box_transform, box_type, world_pos, *voxel_type);
+                box_raycast_wrap_t box_raycast = get_box_raycast_for_voxel(origin, dir, dir_inv, box_transform, box_type, world_pos, voxel_type.val);
                 closest_raycast = get_closest_raycast(closest_raycast, voxel_world_pos, box_raycast);
             }
         }
     }
 
     return closest_raycast;
+}
+
+voxel_raycast_wrap_t get_voxel_raycast(vec3s origin, vec3s dir, vec3s begin, vec3s end, vec3s box_transform, voxel_box_type_t box_type) {
+    s64 start = get_current_us();
+    voxel_raycast_wrap_t raycast = get_voxel_raycast_in_range(origin, dir, begin, end, box_transform, box_type);
+    total_raycast_time += (us_t) (get_current_us() - start);
+    return raycast;
 }
\ No newline at end of file
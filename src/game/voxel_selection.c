@@ -6,6 +6,7 @@
 #include "log.h"
 #include "util.h"
 #include "voxel.h"
+#include "voxel_type_info.h"
 #include <cglm/struct/affine.h>
 #include <cglm/struct/mat4.h>
 #include <ogc/gu.h>
@@ -44,7 +45,7 @@ static bool cull_back = true;
 alignas(32) static u8 disp_list[CUBE_DISP_LIST_SIZE];
 
 void voxel_selection_init(void) {
-    GX_SetVtxAttrFmt(VERTEX_FORMAT_INDEX, GX_VA_POS, GX_POS_XYZ, GX_U8, 2);
+    GX_SetVtxAttrFmt(VERTEX_FORMAT_INDEX, GX_VA_POS, GX_POS_XYZ, GX_U8, REGION_POSITION_FRAC_BITS);
 }
 
 void voxel_selection_update_view(const mat4s* view) {
@@ -95,10 +96,7 @@ void voxel_selection_update(const mat4s* view, s32vec3s voxel_world_pos) {
     s32vec3s region_pos = get_region_position_from_voxel_world_position(voxel_world_pos);
     u32vec3s voxel_local_pos = get_voxel_local_position_from_voxel_world_position(voxel_world_pos);
 
-    REGION_TYPE_3D(const voxel_type_array_t*) voxel_type_arrays = REGION_CAST_3D(const voxel_type_array_t*, region_voxel_type_arrays);
-    u32vec3s region_rel_pos = get_region_relative_position(region_pos);
-
-    voxel_type_t voxel_type = (*voxel_type_arrays)[region_rel_pos.x][region_rel_pos.y][region_rel_pos.z]->types[voxel_local_pos.x][voxel_local_pos.y][voxel_local_pos.z];
+    voxel_type_t voxel_type = get_voxel_type_from_voxel_world_position(voxel_world_pos).val;
 
     // Check if we have a new selected voxel
     if (has_last_selection && voxel_local_pos.x == last_voxel_local_pos.x && voxel_local_pos.y == last_voxel_local_pos.y && voxel_local_pos.z == last_voxel_local_pos.z && voxel_type == last_voxel_type) {
@@ -112,18 +110,18 @@ void voxel_selection_update(const mat4s* view, s32vec3s voxel_world_pos) {
     last_voxel_type = voxel_type;
     
     guMtxIdentity(model.raw);
-    guMtxTransApply(model.raw, model.raw, (f32) region_pos.x * REGION_SIZE, (f32) region_pos.y * REGION_SIZE, (f32) region_pos.z * REGION_SIZE);
+    guMtxTransApply(model.raw, model.raw, (f32) region_pos.x * REGION_SIZE_X, (f32) region_pos.y * REGION_SIZE_Y, (f32) region_pos.z * REGION_SIZE_Z);
 
     voxel_selection_update_view(view);
 
-    u8 px = (u8) voxel_local_pos.x * 4;
-    u8 py = (u8) voxel_local_pos.y * 4;
-    u8 pz = (u8) voxel_local_pos.z * 4;
-    u8 pox = px + 4;
-    u8 poy = py + 4;
-    u8 poz = pz + 4;
+    u8 px = (u8) voxel_local_pos.x * REGION_POSITION_SCALE;
+    u8 py = (u8) voxel_local_pos.y * REGION_POSITION_SCALE;
+    u8 pz = (u8) voxel_local_pos.z * REGION_POSITION_SCALE;
+    u8 pox = px + REGION_POSITION_SCALE;
+    u8 poy = py + REGION_POSITION_SCALE;
+    u8 poz = pz + REGION_POSITION_SCALE;
 
-    switch (voxel_type) {
+    switch (get_voxel_mesh_category(voxel_type)) {
         default:
             cull_back = true;
 
@@ -162,10 +160,10 @@ void voxel_selection_update(const mat4s* view, s32vec3s voxel_world_pos) {
             disp_list_size = GX_EndDispList();
 
             break;
-        case voxel_type_air:
+        case voxel_mesh_category_invisible:
             disp_list_size = 0;
             break;
-        case voxel_type_tall_grass:
+        case voxel_mesh_category_cross:
             cull_back = false;
             
             memset(disp_list, 0, CROSS_DISP_LIST_SIZE);
@@ -0,0 +1,52 @@
+#include "voxel_type_info.h"
+#include "game/region.h"
+
+#define FULL_BOX { { .x = 0.0f, .y = 0.0f, .z = 0.0f }, { .x = 1.0f, .y = 1.0f, .z = 1.0f } }
+
+#define SOLID_CUBE(front, back, top, bottom, right, left) { \
+    .mesh_category = voxel_mesh_category_cube, \
+    .has_collision_box = true, \
+    .has_selection_box = true, \
+    .face_texs = { front, back, top, bottom, right, left }, \
+    .collision_box = FULL_BOX, \
+    .selection_box = FULL_BOX \
+}
+
+#define UNIFORM_SOLID_CUBE(tex) SOLID_CUBE(tex, tex, tex, tex, tex, tex)
+
+const voxel_type_info_t voxel_type_infos[NUM_VOXEL_TYPES] = {
+    [voxel_type_air] = {
+        .mesh_category = voxel_mesh_category_invisible
+    },
+    [voxel_type_debug] = UNIFORM_SOLID_CUBE(0),
+    [voxel_type_grass] = SOLID_CUBE(4, 4, 0, 2, 4, 4),
+    [voxel_type_stone] = UNIFORM_SOLID_CUBE(1),
+    [voxel_type_dirt] = UNIFORM_SOLID_CUBE(2),
+    [voxel_type_sand] = UNIFORM_SOLID_CUBE(6),
+    [voxel_type_wood_planks] = UNIFORM_SOLID_CUBE(10),
+    [voxel_type_stone_slab_both] = SOLID_CUBE(8, 8, 9, 8, 8, 8),
+    [voxel_type_water] = {
+        .mesh_category = voxel_mesh_category_transparent_cube,
+        .has_selection_box = true,
+        .face_texs = { 7, 7, 7, 7, 7, 7 },
+        .selection_box = FULL_BOX
+    },
+    [voxel_type_tall_grass] = {
+        .mesh_category = voxel_mesh_category_cross,
+        .has_selection_box = true,
+        .face_texs = { 5, 5, 5, 5, 5, 5 },
+        .selection_box = {
+            { .x = 0.2f, .y = 0.0f, .z = 0.2f },
+            { .x = 0.8f, .y = 0.8f, .z = 0.8f }
+        }
+    },
+    [voxel_type_glowstone] = {
+        .mesh_category = voxel_mesh_category_cube,
+        .has_collision_box = true,
+        .has_selection_box = true,
+        .face_texs = { 11, 11, 11, 11, 11, 11 },
+        .light_emission = MAX_LIGHT_LEVEL,
+        .collision_box = FULL_BOX,
+        .selection_box = FULL_BOX
+    }
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "math/box.h"
+#include "voxel.h"
+
+typedef enum __attribute__((__packed__)) {
+    voxel_mesh_category_invisible,
+    voxel_mesh_category_cube,
+    voxel_mesh_category_transparent_cube,
+    voxel_mesh_category_cross
+} voxel_mesh_category_t;
+
+static_assert(sizeof(voxel_mesh_category_t) == 1, "");
+
+typedef struct {
+    voxel_mesh_category_t mesh_category;
+    bool has_collision_box;
+    bool has_selection_box;
+    // Texture tile of each voxel_face_t, cross meshes use the front tile
+    u8 face_texs[6];
+    // Block light level that the voxel gives off, up to MAX_LIGHT_LEVEL
+    u8 light_emission;
+    box_t collision_box;
+    box_t selection_box;
+} voxel_type_info_t;
+
+// Indexed by voxel_type_t, every property of a voxel type is looked up here instead of being switched on
+extern const voxel_type_info_t voxel_type_infos[NUM_VOXEL_TYPES];
+
+static inline const voxel_type_info_t* get_voxel_type_info(voxel_type_t type) {
+    return &voxel_type_infos[type];
+}
+
+static inline voxel_mesh_category_t get_voxel_mesh_category(voxel_type_t type) {
+    return voxel_type_infos[type].mesh_category;
+}
+
+// Opaque voxels hide the faces of other voxels and block light
+static inline bool is_voxel_type_opaque(voxel_type_t type) {
+    return voxel_type_infos[type].mesh_category == voxel_mesh_category_cube;
+}
@@ -18,6 +18,10 @@
 #include "game/debug_ui.h"
 #include "log.h"
 #include "game/region_management.h"
+#include "game/region_visual_generation.h"
+#include "game/display_list_pool.h"
+#include "game/region_mesh_cache.h"
+#include "game/region_lighting.h"
 #include <cglm/struct/mat4.h>
 #include <ogc/gu.h>
 #include <stdlib.h>
@@ -67,7 +71,6 @@ int main(int, char**) {
 	voxel_selection_init();
 
 	init_ui_rendering();
-	init_region_rendering();
 
 	GX_SetZMode(GX_TRUE, GX_LEQUAL, GX_TRUE);
 	GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
@@ -82,7 +85,10 @@ int main(int, char**) {
 	
 	s32vec3s last_region_pos = get_region_position_from_voxel_world_position(get_voxel_world_position(cam_position));
 
-	init_region_management();
+	init_display_list_pool();
+	init_region_mesh_cache();
+	init_region_management(last_region_pos);
+	init_region_rendering();
 
 	for (;;) {
         us_t now = (us_t) (get_current_us() - program_start);
@@ -98,20 +104,37 @@ int main(int, char**) {
 		WPAD_ScanPads();
 		u32 buttons_down = WPAD_ButtonsDown(chan);
 		if (buttons_down & WPAD_BUTTON_HOME) {
-			lprintf("BGT: %d\nMGT: %d\nMGL: %d\nLog ended\n", total_procedural_gen_time, total_visual_gen_time, last_visual_gen_time);
+			log_display_list_pool_stats();
+			log_region_mesh_cache_stats();
+			lprintf("Region size: %dx%dx%d\nVoxel layout: %s\nBGT: %d\nMGT: %d\nMGL: %d\nRCT: %d\nStreamed regions: %d\nLog ended\n", REGION_SIZE_X, REGION_SIZE_Y, REGION_SIZE_Z, VOXEL_LAYOUT_NAME, total_procedural_gen_time, total_visual_gen_time, last_visual_gen_time, total_raycast_time, num_streamed_regions);
 			log_term();
 			exit(0);
 		}
 		u32 buttons_held = WPAD_ButtonsHeld(chan);
 
+		if (buttons_down & WPAD_BUTTON_1) {
+			region_mesher = region_mesher == region_mesher_greedy ? region_mesher_per_face : region_mesher_greedy;
+			regenerate_region_visuals();
+		}
+		if (buttons_down & WPAD_BUTTON_PLUS) {
+			region_vertex_format = (region_vertex_format_t) ((region_vertex_format + 1) % NUM_REGION_VERTEX_FORMATS);
+			regenerate_region_visuals();
+		}
+		if (buttons_down & WPAD_BUTTON_MINUS) {
+			region_lods_enabled = !region_lods_enabled;
+			lprintf("LODs: %s\nRegions drawn per LOD: %d %d %d\n", region_lods_enabled ? "on" : "off", num_drawn_regions_per_lod[0], num_drawn_regions_per_lod[1], num_drawn_regions_per_lod[2]);
+		}
+
 		camera_update(frame_delta, buttons_held);
 
 		s32vec3s region_pos = get_region_position_from_voxel_world_position(get_voxel_world_position(cam_position));
 		manage_regions(last_region_pos, region_pos);
 		last_region_pos = region_pos;
+		update_region_jobs();
 
 		cursor_update(render_mode->viWidth, render_mode->viHeight);
 
+		u8 nunchuk_buttons = 0;
 		#ifndef PC_PORT
     	vec3w_t wpad_accel;
 		WPAD_Accel(chan, &wpad_accel);
@@ -121,6 +144,7 @@ int main(int, char**) {
 			const nunchuk_t* nunchuk = &exp.nunchuk;
 			vec2s nunchuk_vector = get_nunchuk_vector(nunchuk);
 			u8 nunchuk_buttons_down = nunchuk->btns;
+			nunchuk_buttons = nunchuk_buttons_down;
 
 			vec3w_t nunchuk_accel = { nunchuk->accel.x, nunchuk->accel.y, nunchuk->accel.z };
 
@@ -139,8 +163,10 @@ int main(int, char**) {
 
 		if (raycast.success) {
 			voxel_selection_update(&view, raycast.val.voxel_world_pos);
-			update_world(&raycast.val, buttons_down);
+			update_world(&raycast.val, buttons_down, nunchuk_buttons);
 		}
+		update_region_lighting();
+		update_dirty_region_visuals();
 		
 		character_apply_physics(frame_delta);
 		character_apply_velocity(frame_delta);
@@ -174,7 +200,7 @@ int main(int, char**) {
 		
 		#ifdef PC_PORT
 		if (++num_frames == 1200) {
-			printf("BGT: %ld\nMGT: %ld\n", total_procedural_gen_time, total_visual_gen_time);
+			printf("Region size: %dx%dx%d\nVoxel layout: %s\nBGT: %ld\nMGT: %ld\nRCT: %ld\n", REGION_SIZE_X, REGION_SIZE_Y, REGION_SIZE_Z, VOXEL_LAYOUT_NAME, total_procedural_gen_time, total_visual_gen_time, total_raycast_time);
 			exit(0);
 		}
 		#endif
@@ -11,7 +11,7 @@ inline size_t align_to_32(size_t n) {
 
 // b must be positive
 inline s32 div_s32(s32 a, s32 b) {
-    return a >= 0 ? a / b : (a / b) - 1;
+    return a >= 0 ? a / b : ((a + 1) / b) - 1;
 }
 
 inline s32 mod_s32(s32 a, s32 b) {